@@ -8,6 +8,13 @@ float scroll_step        = 40;
 float transparency       = 0.4;
 float smooth_scrolling   = 0.0;
 int   n_completion_items = 15;
+int   render_cache_size  = 8;
+int   prefetch_links     = 8;
+int   pinned_cache_size  = 8;
+int   jumplist_size      = 32;
+int   jumplist_pinned    = 4;
+int   printer_list_ttl   = 60;
+int   export_threads     = 0;
 
 /* completion */
 static const char FORMAT_COMMAND[]     = "<b>%s</b>";
@@ -20,11 +27,14 @@ static const char FORMAT_DESCRIPTION[] = "<i>%s</i>";
 /* #define ZATHURA_NO_XDG */
 
 /* directories and files */
-static const char BOOKMARK_FILE[] = "bookmarks";
-static const char ZATHURA_RC[]    = "zathurarc";
-static const char GLOBAL_RC[]     = "/etc/zathurarc";
-static const char CONFIG_DIR[]    = "~/.config/zathura";
-static const char DATA_DIR[]      = "~/.local/share/zathura";
+static const char BOOKMARK_FILE[]     = "bookmarks";
+static const char BOOKMARK_LOG_FILE[] = "bookmarks.log";
+static const char TEXT_CACHE_DIR[]    = "text";
+static const char TRACE_FILE[]        = "trace-%i.json";
+static const char ZATHURA_RC[]        = "zathurarc";
+static const char GLOBAL_RC[]         = "/etc/zathurarc";
+static const char CONFIG_DIR[]        = "~/.config/zathura";
+static const char DATA_DIR[]          = "~/.local/share/zathura";
 
 /* bookmarks */
 enum
@@ -44,6 +54,8 @@ static const char *bm_reserved_names[] =
 
 int save_position = 1;
 int save_zoom_level = 1;
+int autosave_interval = 30; /* seconds */
+int autosave_idle     = 2;
 
 /* look */
 char* font                   = "dejavu sans mono 8";
@@ -82,6 +94,7 @@ char* uri_command = "firefox %s"; /* uri */
 /* additional settings */
 gboolean show_scrollbars = FALSE;
 gboolean scroll_wrap     = TRUE;
+gboolean show_section    = TRUE;
 int adjust_open          = ADJUST_BESTFIT;
 #define SELECTION_STYLE POPPLER_SELECTION_GLYPH
 #define GOTO_MODE GOTO_LABELS /* GOTO_DEFAULT, GOTO_LABELS, GOTO_OFFSET */
@@ -110,6 +123,8 @@ Shortcut shortcuts[] = {
   {GDK_CONTROL_MASK,   GDK_i,             sc_recolor,           NORMAL | FULLSCREEN, {0} },
   {GDK_CONTROL_MASK,   GDK_m,             sc_toggle_inputbar,   NORMAL,     {0} },
   {GDK_CONTROL_MASK,   GDK_n,             sc_toggle_statusbar,  NORMAL,     {0} },
+  {GDK_CONTROL_MASK,   GDK_o,             sc_jump,              NORMAL | FULLSCREEN, { BACKWARD } },
+  {GDK_CONTROL_MASK,   GDK_p,             sc_jump,              NORMAL | FULLSCREEN, { FORWARD } },
   {0,                  GDK_T,             sc_toggle_inputbar,   NORMAL,     {0} },
   {0,                  GDK_t,             sc_toggle_statusbar,  NORMAL,     {0} },
   {0,                  GDK_a,             sc_adjust_window,     NORMAL,     { ADJUST_BESTFIT } },
@@ -218,6 +233,7 @@ Command commands[] = {
   {"coffset",   0,              cmd_correct_offset,  0,            "Correct page offset" },
   {"delbmark",  0,              cmd_delete_bookmark, cc_bookmark,  "Delete bookmark" },
   {"export",    "e",            cmd_export,          cc_export,    "Export images or attached files" },
+  {"grep",      "g",            cmd_grep,            cc_grep,      "Search the documents of a directory" },
   {"info",      "i",            cmd_info,            0,            "Show information about the document" },
   {"map",       "m",            cmd_map,             0,            "Map keybinding to a function" },
   {"open",      "o",            cmd_open,            cc_open,      "Open a file" },
@@ -257,6 +273,8 @@ Setting settings[] = {
   /* name,                   variable,                           type,  render,  re-init, description */
   {"adjust_open",            &(adjust_open),                     'i',   FALSE,   FALSE,   "Adjust mode"},
   {"browser",                &(uri_command),                     's',   FALSE,   FALSE,   "Command to open URIs"},
+  {"autosave_idle",          &(autosave_idle),                   'i',   FALSE,   FALSE,   "Seconds without changes before the position is saved"},
+  {"autosave_interval",      &(autosave_interval),               'i',   FALSE,   FALSE,   "Seconds between periodic position saves"},
   {"completion_bgcolor",     &(completion_bgcolor),              's',   FALSE,   TRUE,    "Completion background color"},
   {"completion_fgcolor",     &(completion_fgcolor),              's',   FALSE,   TRUE,    "Completion foreground color"},
   {"completion_g_bgcolor",   &(completion_g_bgcolor),            's',   FALSE,   TRUE,    "Completion (group) background color"},
@@ -266,10 +284,13 @@ Setting settings[] = {
   {"default_bgcolor",        &(default_bgcolor),                 's',   FALSE,   TRUE,    "Default background color"},
   {"default_fgcolor",        &(default_fgcolor),                 's',   FALSE,   TRUE,    "Default foreground color"},
   {"default_text",           &(default_text),                    's',   FALSE,   FALSE,   "Default text"},
+  {"export_threads",         &(export_threads),                  'i',   FALSE,   FALSE,   "Number of threads used by :export (0 for one per core)"},
   {"font",                   &(font),                            's',   FALSE,   TRUE,    "The used font" },
   {"height",                 &(default_height),                  'i',   FALSE,   FALSE,   "Default window height"},
   {"inputbar_bgcolor",       &(inputbar_bgcolor),                's',   FALSE,   TRUE,    "Inputbar background color"},
   {"inputbar_fgcolor",       &(inputbar_fgcolor),                's',   FALSE,   TRUE,    "Inputbar foreground color"},
+  {"jumplist_pinned",        &(jumplist_pinned),                 'i',   FALSE,   FALSE,   "Number of recent jump targets kept rendered"},
+  {"jumplist_size",          &(jumplist_size),                   'i',   FALSE,   FALSE,   "Number of positions kept in the jump history"},
   {"labels",                 &(Zathura.Global.enable_labelmode), 'b',   FALSE,   TRUE,    "Allow label mode"},
   {"list_printer_command",   &(list_printer_command),            's',   FALSE,   FALSE,   "Command to list printers"},
   {"n_completion_items",     &(n_completion_items),              'i',   FALSE,   FALSE,   "Number of completion items"},
@@ -278,10 +299,14 @@ Setting settings[] = {
   {"notification_w_bgcolor", &(notification_w_bgcolor),          's',   FALSE,   TRUE,    "Notification (warning) background color"},
   {"notification_w_fgcolor", &(notification_w_fgcolor),          's',   FALSE,   TRUE,    "Notification (warning) foreground color"},
   {"offset",                 &(Zathura.PDF.page_offset),         'i',   FALSE,   FALSE,   "Optional page offset" },
+  {"pinned_cache_size",      &(pinned_cache_size),               'i',   FALSE,   FALSE,   "Number of marker and bookmark pages kept rendered"},
+  {"prefetch_links",         &(prefetch_links),                  'i',   FALSE,   FALSE,   "Number of link targets rendered in advance"},
   {"print_command",          &(print_command),                   's',   FALSE,   FALSE,   "Command to print"},
+  {"printer_list_ttl",       &(printer_list_ttl),                'i',   FALSE,   FALSE,   "Seconds the list of printers is cached"},
   {"recolor",                &(Zathura.Global.recolor),          'b',   TRUE,    FALSE,   "Invert the image" },
   {"recolor_darkcolor",      &(recolor_darkcolor),               's',   FALSE,   TRUE,    "Recoloring (dark color)"},
   {"recolor_lightcolor",     &(recolor_lightcolor),              's',   FALSE,   TRUE,    "Recoloring (light color)"},
+  {"render_cache_size",      &(render_cache_size),               'i',   FALSE,   FALSE,   "Number of rendered pages kept in memory"},
   {"save_position",          &(save_position),                   'b',   FALSE,   FALSE,   "Save position in file on quit and restore it on open"},
   {"save_zoom_level",        &(save_zoom_level),                 'b',   FALSE,   FALSE,   "Save zoom level on quit and restore it on open"},
   {"scroll_step",            &(scroll_step),                     'f',   FALSE,   FALSE,   "Scroll step"},
@@ -289,11 +314,13 @@ Setting settings[] = {
   {"scrollbars",             &(show_scrollbars),                 'b',   FALSE,   TRUE,    "Show scrollbars"},
   {"show_statusbar",         &(Zathura.Global.show_statusbar),   'b',   FALSE,   TRUE,    "Show statusbar"},
   {"show_inputbar",          &(Zathura.Global.show_inputbar),    'b',   FALSE,   TRUE,    "Show inputbar"},
+  {"show_section",           &(show_section),                    'b',   FALSE,   FALSE,   "Show the current outline section in the statusbar"},
   {"search_highlight",       &(search_highlight),                's',   FALSE,   TRUE,    "Highlighted results"},
   {"select_text",            &(select_text),                     's',   FALSE,   TRUE,    "Rectangle of the selected text"},
   {"smooth_scrolling",       &(smooth_scrolling),                'f',   FALSE,   TRUE,    "Smooth scrolling"},
   {"statusbar_bgcolor",      &(statusbar_bgcolor),               's',   FALSE,   TRUE,    "Statusbar background color"},
   {"statusbar_fgcolor",      &(statusbar_fgcolor),               's',   FALSE,   TRUE,    "Statusbar foreground color"},
+  {"trace",                  &(Zathura.Trace.enabled),           'b',   FALSE,   FALSE,   "Write a trace of render, search and input events"},
   {"transparency",           &(transparency),                    'f',   FALSE,   FALSE,   "Transparency of rectangles"},
   {"uri_command",            &(uri_command),                     's',   FALSE,   FALSE,   "Command for opening URIs"},
   {"width",                  &(default_width),                   'i',   FALSE,   FALSE,   "Default window width"},
@@ -310,6 +337,7 @@ ShortcutName shortcut_names[] = {
   {"change_mode",       sc_change_mode},
   {"focus_inputbar",    sc_focus_inputbar},
   {"follow",            sc_follow},
+  {"jump",              sc_jump},
   {"navigate",          sc_navigate},
   {"navigate_index",    sc_navigate_index},
   {"quit",              sc_quit},
@@ -11,10 +11,18 @@ DESKTOPPREFIX ?= ${PREFIX}/share/applications
 # libs
 GTK_INC = $(shell pkg-config --cflags gtk+-2.0 poppler-glib)
 GTK_LIB = $(shell pkg-config --libs gtk+-2.0 gthread-2.0 poppler-glib)
+GEN_INC = $(shell pkg-config --cflags cairo)
+GEN_LIB = $(shell pkg-config --libs cairo)
 
 INCS = -I. -I/usr/include ${GTK_INC}
 LIBS = -lc ${GTK_LIB} -lpthread -lm
 
+# test corpus
+CORPUS ?= corpus
+
+# the performance tests need a display
+PERF_RUNNER ?= $(if ${DISPLAY},,xvfb-run -a)
+
 # compiler flags
 CFLAGS += -std=c99 -pedantic -Wall $(INCS)
 
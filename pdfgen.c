@@ -0,0 +1,372 @@
+/* See LICENSE file for license and copyright information */
+
+/* Generates reproducible stress documents for performance testing */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <cairo.h>
+#include <cairo-pdf.h>
+
+/* macros */
+#define LENGTH(x) (sizeof(x)/sizeof((x)[0]))
+#define PAGE_WIDTH  595.0
+#define PAGE_HEIGHT 842.0
+#define HAS_TAGS (CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 16, 0))
+#define FONT        "DejaVu Serif"
+#define CREATE_DATE "2010-01-01T00:00:00Z"
+
+/* typedefs */
+typedef struct
+{
+  char* name;
+  int (*function)(const char*, int);
+  int pages;
+  char* description;
+} Generator;
+
+/* function declarations */
+unsigned int random_number(void);
+const char* random_word(void);
+cairo_t* create_document(const char*, cairo_surface_t**);
+int finish_document(cairo_t*, cairo_surface_t*);
+void show_text_page(cairo_t*, int);
+int generate_text(const char*, int);
+int generate_paths(const char*, int);
+int generate_images(const char*, int);
+int generate_outline(const char*, int);
+int generate_links(const char*, int);
+
+/* generators */
+Generator generators[] = {
+  /* name,     function,          pages,  description */
+  {"text",     generate_text,     10000,  "Pages full of text"},
+  {"paths",    generate_paths,    4,      "Pages with hundreds of thousands of vector paths"},
+  {"images",   generate_images,   4,      "Pages with huge embedded images"},
+  {"outline",  generate_outline,  500,    "An outline with 50000 entries nested 10 levels deep"},
+  {"links",    generate_links,    2000,   "Labeled pages with many links"},
+};
+
+/* the output has to be identical on every run */
+static unsigned int seed = 1;
+
+static const char* words[] = {
+  "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+  "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+  "et", "dolore", "magna", "aliqua", "enim", "ad", "minim", "veniam",
+  "quis", "nostrud", "exercitation", "ullamco", "laboris", "nisi", "the",
+};
+
+/* function implementation */
+unsigned int
+random_number(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed / 65536) % 32768;
+}
+
+const char*
+random_word(void)
+{
+  return words[random_number() % LENGTH(words)];
+}
+
+cairo_t*
+create_document(const char* file, cairo_surface_t** surface)
+{
+  *surface = cairo_pdf_surface_create(file, PAGE_WIDTH, PAGE_HEIGHT);
+  if(cairo_surface_status(*surface) != CAIRO_STATUS_SUCCESS)
+  {
+    fprintf(stderr, "error: could not create %s\n", file);
+    cairo_surface_destroy(*surface);
+    return NULL;
+  }
+
+#if HAS_TAGS
+  /* the current time would end up in the document otherwise */
+  cairo_pdf_surface_set_metadata(*surface, CAIRO_PDF_METADATA_CREATE_DATE, CREATE_DATE);
+#endif
+
+  cairo_t* cairo = cairo_create(*surface);
+  cairo_select_font_face(cairo, FONT, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+
+  return cairo;
+}
+
+int
+finish_document(cairo_t* cairo, cairo_surface_t* surface)
+{
+  cairo_destroy(cairo);
+  cairo_surface_finish(surface);
+
+  cairo_status_t status = cairo_surface_status(surface);
+  cairo_surface_destroy(surface);
+
+  if(status != CAIRO_STATUS_SUCCESS)
+  {
+    fprintf(stderr, "error: %s\n", cairo_status_to_string(status));
+    return 1;
+  }
+
+  return 0;
+}
+
+void
+show_text_page(cairo_t* cairo, int page)
+{
+  char line[256];
+  double y;
+
+  cairo_set_source_rgb(cairo, 0, 0, 0);
+  cairo_set_font_size(cairo, 10);
+
+  for(y = 50; y < PAGE_HEIGHT - 50; y += 12)
+  {
+    line[0] = '\0';
+    while(strlen(line) < 90)
+    {
+      strcat(line, random_word());
+      strcat(line, " ");
+    }
+
+    cairo_move_to(cairo, 50, y);
+    cairo_show_text(cairo, line);
+  }
+
+  snprintf(line, sizeof(line), "%i", page + 1);
+  cairo_move_to(cairo, PAGE_WIDTH / 2, PAGE_HEIGHT - 25);
+  cairo_show_text(cairo, line);
+}
+
+int
+generate_text(const char* file, int pages)
+{
+  cairo_surface_t* surface;
+  cairo_t* cairo = create_document(file, &surface);
+  if(!cairo)
+    return 1;
+
+  int page;
+  for(page = 0; page < pages; page++)
+  {
+    show_text_page(cairo, page);
+    cairo_show_page(cairo);
+  }
+
+  return finish_document(cairo, surface);
+}
+
+int
+generate_paths(const char* file, int pages)
+{
+  cairo_surface_t* surface;
+  cairo_t* cairo = create_document(file, &surface);
+  if(!cairo)
+    return 1;
+
+  cairo_set_line_width(cairo, 0.2);
+
+  /* every path is stroked on its own so none of them can be merged */
+  int page, i;
+  for(page = 0; page < pages; page++)
+  {
+    for(i = 0; i < 200000; i++)
+    {
+      double x = random_number() % (int) PAGE_WIDTH;
+      double y = random_number() % (int) PAGE_HEIGHT;
+
+      cairo_set_source_rgb(cairo, (random_number() % 256) / 255.0,
+          (random_number() % 256) / 255.0, (random_number() % 256) / 255.0);
+      cairo_move_to(cairo, x, y);
+      cairo_rel_line_to(cairo, (random_number() % 21) - 10.0, (random_number() % 21) - 10.0);
+      cairo_rel_line_to(cairo, (random_number() % 21) - 10.0, (random_number() % 21) - 10.0);
+      cairo_stroke(cairo);
+    }
+
+    cairo_show_page(cairo);
+  }
+
+  return finish_document(cairo, surface);
+}
+
+int
+generate_images(const char* file, int pages)
+{
+  cairo_surface_t* surface;
+  cairo_t* cairo = create_document(file, &surface);
+  if(!cairo)
+    return 1;
+
+  int width  = 8000;
+  int height = 8000;
+
+  int page, x, y;
+  for(page = 0; page < pages; page++)
+  {
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    if(cairo_surface_status(image) != CAIRO_STATUS_SUCCESS)
+    {
+      fprintf(stderr, "error: out of memory\n");
+      cairo_surface_destroy(image);
+      cairo_destroy(cairo);
+      cairo_surface_destroy(surface);
+      return 1;
+    }
+
+    /* noise keeps the image from compressing well */
+    cairo_surface_flush(image);
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int rowstride       = cairo_image_surface_get_stride(image);
+
+    for(y = 0; y < height; y++)
+    {
+      unsigned int* row = (unsigned int*) (data + y * rowstride);
+      for(x = 0; x < width; x++)
+        row[x] = ((x * 255 / width) << 16) | ((y * 255 / height) << 8) | (random_number() & 0xFF);
+    }
+
+    cairo_surface_mark_dirty(image);
+
+    cairo_save(cairo);
+    cairo_scale(cairo, PAGE_WIDTH / width, PAGE_HEIGHT / height);
+    cairo_set_source_surface(cairo, image, 0, 0);
+    cairo_paint(cairo);
+    cairo_restore(cairo);
+
+    cairo_show_page(cairo);
+    cairo_surface_destroy(image);
+  }
+
+  return finish_document(cairo, surface);
+}
+
+int
+generate_outline(const char* file, int pages)
+{
+#if HAS_TAGS
+  cairo_surface_t* surface;
+  cairo_t* cairo = create_document(file, &surface);
+  if(!cairo)
+    return 1;
+
+  int page;
+  for(page = 0; page < pages; page++)
+  {
+    show_text_page(cairo, page);
+    cairo_show_page(cairo);
+  }
+
+  /* chains of entries that are nested 10 levels deep */
+  int parents[10];
+  char title[64];
+  char link[64];
+
+  int i;
+  for(i = 0; i < 50000; i++)
+  {
+    int depth = i % 10;
+
+    snprintf(title, sizeof(title), "Section %i.%i", i / 10 + 1, depth + 1);
+    snprintf(link,  sizeof(link),  "page=%i pos=[0 0]", (int) ((double) i * pages / 50000) + 1);
+
+    parents[depth] = cairo_pdf_surface_add_outline(surface,
+        depth ? parents[depth - 1] : CAIRO_PDF_OUTLINE_ROOT, title, link, 0);
+  }
+
+  return finish_document(cairo, surface);
+#else
+  fprintf(stderr, "error: outlines need cairo 1.16\n");
+  return 1;
+#endif
+}
+
+int
+generate_links(const char* file, int pages)
+{
+#if HAS_TAGS
+  cairo_surface_t* surface;
+  cairo_t* cairo = create_document(file, &surface);
+  if(!cairo)
+    return 1;
+
+  char label[64];
+  char link[128];
+
+  cairo_set_font_size(cairo, 8);
+
+  int page, i;
+  for(page = 0; page < pages; page++)
+  {
+    /* roman numbered front matter, then numbered chapters */
+    if(page < 20)
+    {
+      static const char* roman[] = { "i", "ii", "iii", "iv", "v", "vi", "vii", "viii", "ix", "x" };
+      snprintf(label, sizeof(label), "%s%s", (page >= 10) ? "x" : "", roman[page % 10]);
+    }
+    else
+      snprintf(label, sizeof(label), "%i-%i", (page - 20) / 100 + 1, (page - 20) % 100 + 1);
+
+    cairo_pdf_surface_set_page_label(surface, label);
+
+    /* a grid of links to other pages and to the web */
+    for(i = 0; i < 200; i++)
+    {
+      double x = 40 + (i % 10) * 52;
+      double y = 60 + (i / 10) * 38;
+
+      if(i % 20 == 19)
+        snprintf(link, sizeof(link), "uri='https://example.org/%i/%i'", page, i);
+      else
+        snprintf(link, sizeof(link), "page=%i pos=[0 0]", (int) (random_number() % pages) + 1);
+
+      cairo_tag_begin(cairo, CAIRO_TAG_LINK, link);
+      cairo_move_to(cairo, x, y);
+      cairo_show_text(cairo, random_word());
+      cairo_tag_end(cairo, CAIRO_TAG_LINK);
+    }
+
+    cairo_show_page(cairo);
+  }
+
+  return finish_document(cairo, surface);
+#else
+  fprintf(stderr, "error: links and page labels need cairo 1.16\n");
+  return 1;
+#endif
+}
+
+/* main function */
+int main(int argc, char* argv[])
+{
+  if(argc < 3)
+  {
+    fprintf(stderr, "usage: %s <type> <file> [pages]\n\ntypes:\n", argv[0]);
+
+    int i;
+    for(i = 0; i < LENGTH(generators); i++)
+      fprintf(stderr, "  %-10s %s (%i pages)\n", generators[i].name,
+          generators[i].description, generators[i].pages);
+
+    return 1;
+  }
+
+  int i;
+  for(i = 0; i < LENGTH(generators); i++)
+  {
+    if(!strcmp(argv[1], generators[i].name))
+    {
+      int pages = (argc > 3) ? atoi(argv[3]) : generators[i].pages;
+      if(pages <= 0)
+      {
+        fprintf(stderr, "error: invalid number of pages\n");
+        return 1;
+      }
+
+      return generators[i].function(argv[2], pages);
+    }
+  }
+
+  fprintf(stderr, "error: unknown type %s\n", argv[1]);
+  return 1;
+}
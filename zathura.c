@@ -10,6 +10,18 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <math.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
 
 #include <poppler/glib/poppler.h>
 #include <cairo.h>
@@ -20,6 +32,13 @@
 
 /* macros */
 #define LENGTH(x) (sizeof(x)/sizeof((x)[0]))
+#define LINK_GRID_SIZE 64
+#define DIRECTORY_CACHE_SIZE 16
+#define EXPORT_QUEUE_SIZE 16
+#define TRACE_BEGIN() (G_UNLIKELY(Zathura.Trace.enabled) ? g_get_monotonic_time() : 0)
+#define TRACE_END(category, name, start) do { if(start) trace_event(category, name, start); } while(0)
+#define LOCK(name) (G_UNLIKELY(Zathura.Trace.enabled) ? trace_lock(&(Zathura.Lock.name), #name) : \
+    g_static_mutex_lock(&(Zathura.Lock.name)))
 #define CLEAN(m) (m & ~(GDK_MOD2_MASK) & ~(GDK_BUTTON1_MASK) & ~(GDK_BUTTON2_MASK) & ~(GDK_BUTTON3_MASK) & ~(GDK_BUTTON4_MASK) & ~(GDK_BUTTON5_MASK) & ~(GDK_LEAVE_NOTIFY_MASK))
 #if defined(__GNUC__) || defined(__INTEL_COMPILER) || defined(__ICL) || defined(__ICC) || defined(__ECC) || defined(__clang__)
 /* only gcc, clang and Intel's cc seem support this */
@@ -79,7 +98,6 @@ typedef struct
   char*      description;
   int        command_id;
   gboolean   is_group;
-  GtkWidget* row;
 } CompletionRow;
 
 typedef struct
@@ -163,19 +181,127 @@ struct SCList
 
 typedef struct SCList ShortcutList;
 
+typedef struct
+{
+  cairo_surface_t *surface;
+  gchar           *file;
+} ExportImage;
+
+struct EJob
+{
+  const char   *description;
+  const char   *unit;
+  const char   *empty;
+  gchar        *uri;
+  gchar        *password;
+  gchar        *path;
+  gchar        *name;
+  int           first_page;
+  int           last_page;
+  int           scale;
+  int           rotate;
+  gboolean      recolor;
+  gboolean      ppm;
+  FILE         *output;
+  GMutex       *mutex;
+  GCond        *cond;
+  gchar       **texts;
+  int           next_write;
+  void        (*export_page)(struct EJob*, PopplerDocument*, int);
+  GThread     **threads;
+  int           number_of_threads;
+  int           number_of_encoders;
+  int           running;
+  int           extractors;
+  int           next_page;
+  int           pages_done;
+  int           written;
+  int           errors;
+  int           cancel;
+  GAsyncQueue  *images;
+  GAsyncQueue  *slots;
+};
+
+typedef struct EJob ExportJob;
+
+typedef struct
+{
+  gchar           *source;
+  gchar           *target;
+  gchar           *tmp;
+  PopplerDocument *document;
+  GThread         *thread;
+  int              progress;
+  int              cancel;
+  gboolean         success;
+  gchar           *error;
+} SaveJob;
+
 typedef struct
 {
   char* identifier;
   int   key;
 } GDKKey;
 
+typedef struct
+{
+  PopplerRectangle area;
+  PopplerRectangle device;
+  PopplerAction*   action;
+} Link;
+
+typedef struct
+{
+  GList   *mapping;
+  Link    *links;
+  int      number_of_links;
+  double   page_width;
+  double   page_height;
+  int      scale;
+  int      rotate;
+  int      columns;
+  int      rows;
+  GSList **cells;
+} PageLinks;
+
+typedef struct
+{
+  gchar            *text;
+  PopplerRectangle *rectangles;
+  PopplerRectangle *device;
+  guint             length;
+  double            page_width;
+  double            page_height;
+  int               scale;
+  int               rotate;
+} PageText;
+
 typedef struct
 {
   PopplerPage *page;
   int          id;
   char        *label;
+  PageLinks   *links;
+  PageText    *text;
+  double       width;
+  double       height;
 } Page;
 
+typedef struct
+{
+  gchar    *description;
+  gboolean  report_success;
+} ChildProcess;
+
+typedef struct
+{
+  gchar        *path;
+  GPtrArray    *entries;
+  GFileMonitor *monitor;
+  gboolean      loading;
+  guint         generation;
+} DirectoryListing;
+
 typedef struct
 {
   char* name;
@@ -199,6 +325,12 @@ typedef struct
   PagePosition position;
 } Marker;
 
+typedef struct
+{
+  int page;
+  PagePosition position;
+} Jump;
+
 typedef struct
 {
   char* id;
@@ -207,6 +339,74 @@ typedef struct
   PagePosition position;
 } Bookmark;
 
+typedef struct
+{
+  gboolean     has_position;
+  int          page;
+  int          offset;
+  int          scale;
+  PagePosition position;
+  GList       *bookmarks;
+} BookmarkRecord;
+
+typedef struct
+{
+  char* file;
+  int   page;
+  char* context;
+} GrepHit;
+
+typedef struct
+{
+  gchar*      pattern;
+  gchar*      directory;
+  GList*      hits;
+  GMutex*     lock;
+  const char* message;
+} GrepJob;
+
+typedef struct
+{
+  int              page_id;
+  int              scale;
+  int              rotate;
+  gboolean         recolor;
+  cairo_surface_t *surface;
+} RenderCacheEntry;
+
+typedef struct
+{
+  int      page_id;
+  int      scale;
+  int      rotate;
+  gboolean recolor;
+  int      priority;
+  gboolean pin;
+} RenderJob;
+
+typedef struct
+{
+  int   page;
+  int   order;
+  char* title;
+} Section;
+
+typedef struct
+{
+  Section* sections;
+  int      number_of_sections;
+} SectionIndex;
+
+typedef struct
+{
+  char*  name;
+  char*  document;
+  double (*function)(void);
+  int    iterations;
+  double p50_budget;
+  double p95_budget;
+} PerfTest;
+
 /* zathura */
 struct
 {
@@ -268,11 +468,17 @@ struct
     gboolean  show_index;
     gboolean  show_statusbar;
     gboolean  show_inputbar;
+    gboolean  link_hover;
+    gchar    *pending_completion;
   } Global;
 
   struct
   {
     ShortcutList  *sclist;
+    GHashTable    *sctable;
+    regex_t       *bcregex;
+    regex_t        bcmatcher;
+    gboolean       bcmatcher_valid;
   } Bindings;
 
   struct
@@ -281,6 +487,14 @@ struct
     gdouble y;
   } SelectPoint;
 
+  struct
+  {
+    gboolean active;
+    int      page;
+    int      first;
+    int      last;
+  } Selection;
+
   struct
   {
     char* filename;
@@ -295,6 +509,15 @@ struct
     int last;
   } Marker;
 
+  struct
+  {
+    Jump*    list;
+    int      size;
+    int      first;
+    int      count;
+    int      current;
+  } Jumps;
+
   struct
   {
     GFileMonitor* monitor;
@@ -303,10 +526,26 @@ struct
 
   struct
   {
-    GKeyFile *data;
-    char     *file;
-    Bookmark *bookmarks;
-    int       number_of_bookmarks;
+    GHashTable *documents;
+    char       *file;
+    int         fd;
+    ino_t       inode;
+    off_t       offset;
+    int         records;
+    GQueue     *queue;
+    GHashTable *queued_positions;
+    GList      *writing;
+    gchar      *snapshot;
+    ino_t       snapshot_inode;
+    off_t       snapshot_offset;
+    gchar      *last_position;
+    GCond      *cond;
+    gboolean    stop;
+    guint       autosave;
+    guint       idle_save;
+    gint64      last_activity;
+    Bookmark   *bookmarks;
+    int         number_of_bookmarks;
   } Bookmarks;
 
   struct
@@ -321,6 +560,9 @@ struct
     int              scale;
     int              rotate;
     cairo_surface_t *surface;
+    gboolean         surface_shared;
+    GHashTable      *destinations;
+    SectionIndex    *sections;
   } PDF;
 
   struct
@@ -329,6 +571,9 @@ struct
     GStaticMutex pdf_obj_lock;
     GStaticMutex search_lock;
     GStaticMutex select_lock;
+    GStaticMutex render_lock;
+    GStaticMutex bookmarks_lock;
+    GStaticMutex trace_lock;
   } Lock;
 
   struct
@@ -339,10 +584,54 @@ struct
     gchar* query;
   } Search;
 
+  struct
+  {
+    GList* hits;
+  } Grep;
+
+  struct
+  {
+    GQueue* pending;
+    guint   builder;
+  } Index;
+
+  struct
+  {
+    GHashTable* listings;
+    guint       generation;
+  } Directories;
+
+  struct
+  {
+    gchar**  list;
+    gint64   updated;
+    gboolean loading;
+  } Printers;
+
+  struct
+  {
+    GList* jobs;
+    GList* saves;
+    guint  progress;
+  } Export;
+
+  struct
+  {
+    GQueue*      cache;
+    GList*       pinned;
+    GThreadPool* pool;
+    gboolean     stop;
+  } Render;
+
   struct
   {
     GThread* search_thread;
     gboolean search_thread_running;
+    GThread* grep_thread;
+    gboolean grep_thread_running;
+    GThread* scan_thread;
+    gboolean scan_thread_running;
+    GThread* bookmarks_thread;
     GThread* inotify_thread;
   } Thread;
 
@@ -362,6 +651,14 @@ struct
   {
     gchar* file;
   } StdinSupport;
+
+  struct
+  {
+    gboolean enabled;
+    gboolean closed;
+    FILE*    file;
+    int      events;
+  } Trace;
 } Zathura;
 
 
@@ -370,40 +667,98 @@ void init_look(void);
 void init_directories(void);
 void init_bookmarks(void);
 void init_keylist(void);
+void build_shortcut_table(void);
 void init_settings(void);
 void init_zathura(void);
 void add_marker(int);
+void add_jump(void);
+Jump* get_jump(int);
+void free_jumps(void);
 void build_index(GtkTreeModel*, GtkTreeIter*, PopplerIndexIter*);
+void expand_index(GtkTreeModel*, GtkTreeIter*);
+void free_index(void);
 void change_mode(int);
 void calculate_offset(GtkWidget*, double*, double*);
 void close_file(gboolean);
 void enter_password(void);
 void highlight_result(int, PopplerRectangle*);
 void draw(int);
+cairo_t* create_page_context(void);
+cairo_surface_t* render_page(PopplerPage*, int, int, gboolean, gboolean);
+cairo_surface_t* render_cache_lookup(int, int, int, gboolean);
+void render_cache_insert(int, int, int, gboolean, cairo_surface_t*);
+void render_cache_clear(void);
+void render_cache_pin(int, int, int, gboolean, cairo_surface_t*);
+void update_pinned_pages(void);
+void prefetch_links_of_page(int);
+gint compare_render_jobs(gconstpointer, gconstpointer, gpointer);
 void eval_marker(int);
 void notify(int, const char*);
 gboolean open_file(char*, char*);
 gboolean open_stdin(gchar*);
 void open_uri(char*);
+gboolean spawn_command(char*, const char*, gboolean);
 void out_of_memory(void) NORETURN;
+void trace_event(const char*, const char*, gint64);
+void trace_lock(GStaticMutex*, const char*);
+void close_trace(void);
+gboolean handle_key_press(GdkEventKey*);
 void update_status(void);
 void read_bookmarks_file(void);
-void write_bookmarks_file(void);
+void migrate_bookmarks_file(const char*);
+void apply_bookmark_record(gchar*);
+void store_bookmark_record(gchar*, const gchar*);
+void store_position(void);
+void compact_bookmarks_file(void);
+void load_bookmarks(const char*);
 void free_bookmarks(void);
+void free_bookmark_record(gpointer);
 void read_configuration_file(const char*);
 void read_configuration(void);
 void recalc_rectangle(int, PopplerRectangle*);
-void set_completion_row_color(GtkBox*, int, int);
+void transform_rectangle(PopplerRectangle*, double, double, double, int);
+PageLinks* get_page_links(int);
+void get_page_size(int, double*, double*);
+void free_page_links(PageLinks*);
+Link* find_link(int, double, double);
+PageText* get_page_text_layout(int);
+void free_page_text_layout(PageText*);
+int find_glyph(PageText*, double, double);
+gboolean follow_link(PopplerAction*);
+void update_completion_row(GtkEventBox*, char*, char*, gboolean, int);
 void set_page(int);
 void switch_view(GtkWidget*);
 void save_page_position(PagePosition*, int);
 void restore_page_position(PagePosition*);
-void position_bookmark(Bookmark*, const gchar*, const gchar*);
 GtkEventBox* create_completion_row(GtkBox*, char*, char*, gboolean);
 gchar* fix_path(const gchar*);
 gchar* path_from_env(const gchar*);
 gchar* get_home_dir(void);
 gboolean is_reserved_bm_name(const char *);
+int get_number_of_workers(void);
+gchar* get_page_text(PopplerPage*);
+gchar** get_document_text(const gchar*);
+void free_grep_hits(GList*);
+gint compare_grep_hits(gconstpointer, gconstpointer);
+int find_dest_page(PopplerDest*);
+gint compare_sections(gconstpointer, gconstpointer);
+void free_sections(SectionIndex*);
+const char* get_section_title(int);
+DirectoryListing* get_directory_listing(const char*);
+void free_directory_listing(gpointer);
+void update_printers(void);
+void wait_for_completion(void);
+void refresh_completion(void);
+int get_number_of_export_workers(void);
+ExportJob* create_export_job(const char*, int, int);
+gboolean parse_page_range(const char*, int*, int*);
+gboolean write_ppm(cairo_surface_t*, const char*);
+void start_export_job(ExportJob*, int);
+void cancel_export_job(ExportJob*);
+void finish_export_extractor(ExportJob*);
+void finish_export_thread(ExportJob*);
+void free_export_job(ExportJob*);
+void update_status_text(void);
 
 Completion* completion_init(void);
 CompletionGroup* completion_group_create(char*);
@@ -413,6 +768,28 @@ void completion_group_add_element(CompletionGroup*, char*, char*);
 
 /* thread declaration */
 void* search(void*);
+void* grep(void*);
+void grep_document(gpointer, gpointer);
+void render_job(gpointer, gpointer);
+void* write_bookmarks(void*);
+gboolean lock_bookmarks_file(void);
+gchar* read_bookmarks_tail(off_t, off_t);
+void* scan_document(void*);
+void* read_directory(void*);
+void* read_printers(void*);
+void* export_worker(void*);
+void* export_encoder(void*);
+void export_page_images(ExportJob*, PopplerDocument*, int);
+void export_page_raster(ExportJob*, PopplerDocument*, int);
+void export_page_text(ExportJob*, PopplerDocument*, int);
+void* save_document(void*);
+gboolean copy_document(SaveJob*, int);
+gboolean scan_index(PopplerIndexIter*, GPtrArray*);
+#if POPPLER_CHECK_VERSION(0,78,0)
+gboolean scan_add_destination(gpointer, gpointer, gpointer);
+#else
+void scan_add_action(PopplerAction*, GHashTable*);
+#endif
 
 /* shortcut declarations */
 void sc_abort(Argument*);
@@ -421,6 +798,7 @@ void sc_change_buffer(Argument*);
 void sc_change_mode(Argument*);
 void sc_focus_inputbar(Argument*);
 void sc_follow(Argument*);
+void sc_jump(Argument*);
 void sc_navigate(Argument*);
 void sc_paginate(Argument*);
 void sc_recolor(Argument*);
@@ -451,6 +829,7 @@ gboolean cmd_close(int, char**);
 gboolean cmd_correct_offset(int, char**);
 gboolean cmd_delete_bookmark(int, char**);
 gboolean cmd_export(int, char**);
+gboolean cmd_grep(int, char**);
 gboolean cmd_info(int, char**);
 gboolean cmd_map(int, char**);
 gboolean cmd_open(int, char**);
@@ -464,6 +843,7 @@ gboolean cmd_savef(int, char**);
 /* completion commands */
 Completion* cc_bookmark(char*);
 Completion* cc_export(char*);
+Completion* cc_grep(char*);
 Completion* cc_open(char*);
 Completion* cc_print(char*);
 Completion* cc_set(char*);
@@ -480,12 +860,24 @@ gboolean scmd_search(gchar*, Argument*);
 
 /* callback declarations */
 gboolean cb_destroy(GtkWidget*, gpointer);
+gboolean cb_directory_read(gpointer);
+gboolean cb_printers_read(gpointer);
+gboolean cb_export_finished(gpointer);
+gboolean cb_export_progress(gpointer);
+gboolean cb_save_finished(gpointer);
+void cb_directory_changed(GFileMonitor*, GFile*, GFile*, GFileMonitorEvent, gpointer);
 gboolean cb_draw(GtkWidget*, GdkEventExpose*, gpointer);
+gboolean cb_index_build(gpointer);
 gboolean cb_index_row_activated(GtkTreeView*, GtkTreePath*, GtkTreeViewColumn*, gpointer);
+gboolean cb_index_row_expand(GtkTreeView*, GtkTreeIter*, GtkTreePath*, gpointer);
 gboolean cb_inputbar_kb_pressed(GtkWidget*, GdkEventKey*, gpointer);
 gboolean cb_inputbar_activate(GtkEntry*, gpointer);
 gboolean cb_inputbar_form_activate(GtkEntry*, gpointer);
 gboolean cb_inputbar_password_activate(GtkEntry*, gpointer);
+gboolean cb_update_status(gpointer);
+gboolean cb_autosave(gpointer);
+gboolean cb_idle_save(gpointer);
+void cb_child_exited(GPid, gint, gpointer);
 gboolean cb_view_kb_pressed(GtkWidget*, GdkEventKey*, gpointer);
 gboolean cb_view_resized(GtkWidget*, GtkAllocation*, gpointer);
 gboolean cb_view_button_pressed(GtkWidget*, GdkEventButton*, gpointer);
@@ -494,6 +886,31 @@ gboolean cb_view_motion_notify(GtkWidget*, GdkEventMotion*, gpointer);
 gboolean cb_view_scrolled(GtkWidget*, GdkEventScroll*, gpointer);
 gboolean cb_watch_file(GFileMonitor*, GFile*, GFile*, GFileMonitorEvent, gpointer);
 
+/* benchmark declarations */
+int run_benchmark(char*, char*, const char*, const char*, const char*, char**);
+void print_json_string(const char*);
+void print_latency_statistics(double*, int);
+int compare_latencies(const void*, const void*);
+double get_percentile(double*, int, double);
+int run_perf_test(char*);
+void flush_events(void);
+double perf_page_turn(void);
+double perf_scroll(void);
+double perf_zoom(void);
+double perf_search(void);
+double perf_toggle_index(void);
+
+/* performance tests, the budgets are in milliseconds */
+PerfTest perf_tests[] = {
+  /* name,          document,       function,          iterations, p50,  p95 */
+  {"page turn",     "text.pdf",     perf_page_turn,    200,        5,    10},
+  {"scroll",        "text.pdf",     perf_scroll,       500,        2,    10},
+  {"zoom",          "text.pdf",     perf_zoom,         100,        15,   30},
+  {"search",        "text.pdf",     perf_search,       100,        20,   50},
+  {"page turn",     "links.pdf",    perf_page_turn,    200,        10,   20},
+  {"index toggle",  "outline.pdf",  perf_toggle_index, 20,         100,  150},
+};
+
 /* configuration */
 #include "config.h"
 
@@ -639,10 +1056,45 @@ init_bookmarks(void)
 {
   /* init variables */
   Zathura.Bookmarks.number_of_bookmarks = 0;
-  Zathura.Bookmarks.bookmarks = NULL;
+  Zathura.Bookmarks.bookmarks  = NULL;
+  Zathura.Bookmarks.documents  = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_bookmark_record);
+  Zathura.Bookmarks.inode      = 0;
+  Zathura.Bookmarks.offset     = 0;
+  Zathura.Bookmarks.records    = 0;
+  Zathura.Bookmarks.queue      = g_queue_new();
+  Zathura.Bookmarks.writing    = NULL;
+  Zathura.Bookmarks.snapshot   = NULL;
+  Zathura.Bookmarks.stop       = FALSE;
+  Zathura.Bookmarks.cond       = g_cond_new();
+  Zathura.Bookmarks.idle_save  = 0;
+  Zathura.Bookmarks.last_activity = 0;
+
+  Zathura.Bookmarks.last_position    = NULL;
+  Zathura.Bookmarks.queued_positions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  Zathura.Bookmarks.file = g_build_filename(Zathura.Config.data_dir, BOOKMARK_LOG_FILE, NULL);
+
+  /* convert the bookmark file of older versions */
+  if(!g_file_test(Zathura.Bookmarks.file, G_FILE_TEST_EXISTS))
+  {
+    char* old_file = g_build_filename(Zathura.Config.data_dir, BOOKMARK_FILE, NULL);
+    if(g_file_test(old_file, G_FILE_TEST_IS_REGULAR))
+      migrate_bookmarks_file(old_file);
+    g_free(old_file);
+  }
+
+  Zathura.Bookmarks.fd = open(Zathura.Bookmarks.file, O_RDWR | O_APPEND | O_CREAT, 0600);
+  if(Zathura.Bookmarks.fd == -1)
+    notify(ERROR, "Could not open bookmark file");
 
-  Zathura.Bookmarks.file = g_build_filename(Zathura.Config.data_dir, BOOKMARK_FILE, NULL);
   read_bookmarks_file();
+
+  /* records are written by a background thread */
+  Zathura.Thread.bookmarks_thread = g_thread_create(write_bookmarks, NULL, TRUE, NULL);
+
+  /* save the position periodically */
+  Zathura.Bookmarks.autosave = (autosave_interval > 0) ?
+    gdk_threads_add_timeout_seconds(autosave_interval, cb_autosave, NULL) : 0;
 }
 
 gboolean
@@ -680,6 +1132,52 @@ init_keylist(void)
 
     p = e;
   }
+
+  build_shortcut_table();
+
+  /* compile the buffer commands once; all of them are also merged into a
+   * single expression so that a key press usually costs one regexec() */
+  Zathura.Bindings.bcregex = malloc(sizeof(regex_t) * LENGTH(buffer_commands));
+  if(!Zathura.Bindings.bcregex)
+    out_of_memory();
+
+  GString* matcher = g_string_new("");
+  for(i = 0; i < LENGTH(buffer_commands); i++)
+  {
+    if(regcomp(&(Zathura.Bindings.bcregex[i]), buffer_commands[i].regex, REG_EXTENDED | REG_NOSUB) != 0)
+    {
+      /* never matches */
+      regcomp(&(Zathura.Bindings.bcregex[i]), "a^", REG_EXTENDED | REG_NOSUB);
+      continue;
+    }
+
+    g_string_append_printf(matcher, "%s(%s)", matcher->len ? "|" : "", buffer_commands[i].regex);
+  }
+
+  Zathura.Bindings.bcmatcher_valid = (matcher->len &&
+      regcomp(&(Zathura.Bindings.bcmatcher), matcher->str, REG_EXTENDED | REG_NOSUB) == 0);
+  g_string_free(matcher, TRUE);
+}
+
+void
+build_shortcut_table(void)
+{
+  /* index the shortcuts by key; every bucket keeps the bindings in list
+   * order so the first matching binding still wins */
+  if(Zathura.Bindings.sctable)
+    g_hash_table_destroy(Zathura.Bindings.sctable);
+
+  Zathura.Bindings.sctable = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_slist_free);
+
+  ShortcutList* sc;
+  for(sc = Zathura.Bindings.sclist; sc; sc = sc->next)
+  {
+    gpointer key   = GINT_TO_POINTER(sc->element.key);
+    GSList* bucket = g_hash_table_lookup(Zathura.Bindings.sctable, key);
+
+    g_hash_table_steal(Zathura.Bindings.sctable, key);
+    g_hash_table_insert(Zathura.Bindings.sctable, key, g_slist_append(bucket, &(sc->element)));
+  }
 }
 
 void
@@ -699,6 +1197,9 @@ init_zathura(void)
   g_static_mutex_init(&(Zathura.Lock.search_lock));
   g_static_mutex_init(&(Zathura.Lock.pdf_obj_lock));
   g_static_mutex_init(&(Zathura.Lock.select_lock));
+  g_static_mutex_init(&(Zathura.Lock.render_lock));
+  g_static_mutex_init(&(Zathura.Lock.bookmarks_lock));
+  g_static_mutex_init(&(Zathura.Lock.trace_lock));
 
   /* other */
   Zathura.Global.mode           = NORMAL;
@@ -709,6 +1210,13 @@ init_zathura(void)
   Zathura.Global.show_inputbar  = TRUE;
   Zathura.Global.show_statusbar = TRUE;
 
+  Zathura.Global.pending_completion = NULL;
+
+  Zathura.Trace.enabled = FALSE;
+  Zathura.Trace.closed  = FALSE;
+  Zathura.Trace.file    = NULL;
+  Zathura.Trace.events  = 0;
+
   Zathura.State.pages             = g_strdup("");
   Zathura.State.scroll_percentage = 0;
 
@@ -716,11 +1224,35 @@ init_zathura(void)
   Zathura.Marker.number_of_markers =  0;
   Zathura.Marker.last              = -1;
 
+  Zathura.Jumps.list       = NULL;
+  Zathura.Jumps.size       = 0;
+  Zathura.Jumps.first      = 0;
+  Zathura.Jumps.count      = 0;
+  Zathura.Jumps.current    = 0;
+
   Zathura.Search.results = NULL;
   Zathura.Search.page    = 0;
   Zathura.Search.draw    = FALSE;
   Zathura.Search.query   = NULL;
 
+  Zathura.Grep.hits = NULL;
+
+  Zathura.Index.pending = g_queue_new();
+  Zathura.Index.builder = 0;
+
+  Zathura.Render.cache = g_queue_new();
+
+  Zathura.Directories.listings   = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_directory_listing);
+  Zathura.Directories.generation = 0;
+
+  Zathura.Printers.list    = NULL;
+  Zathura.Printers.updated = 0;
+  Zathura.Printers.loading = FALSE;
+
+  Zathura.Export.jobs     = NULL;
+  Zathura.Export.saves    = NULL;
+  Zathura.Export.progress = 0;
+
   Zathura.FileMonitor.monitor = NULL;
   Zathura.FileMonitor.file    = NULL;
 
@@ -850,12 +1382,70 @@ add_marker(int id)
   save_page_position(&Zathura.Marker.markers[marker_index].position, 0);
 }
 
+void
+add_jump(void)
+{
+  if(!Zathura.PDF.document || jumplist_size <= 0)
+    return;
+
+  /* (re)allocate the ring if its size has been changed */
+  if(!Zathura.Jumps.list || Zathura.Jumps.size != jumplist_size)
+  {
+    free_jumps();
+
+    Zathura.Jumps.list = malloc(sizeof(Jump) * jumplist_size);
+    if(!Zathura.Jumps.list)
+      out_of_memory();
+    Zathura.Jumps.size = jumplist_size;
+  }
+
+  /* a new jump discards the forward history */
+  Zathura.Jumps.count = Zathura.Jumps.current;
+
+  /* drop the oldest entry if the ring is full */
+  if(Zathura.Jumps.count == Zathura.Jumps.size)
+  {
+    Zathura.Jumps.first = (Zathura.Jumps.first + 1) % Zathura.Jumps.size;
+    Zathura.Jumps.count--;
+  }
+
+  Jump* jump = get_jump(Zathura.Jumps.count++);
+  jump->page = Zathura.PDF.page_number;
+  save_page_position(&(jump->position), 0);
+
+  Zathura.Jumps.current = Zathura.Jumps.count;
+}
+
+Jump*
+get_jump(int index)
+{
+  return &(Zathura.Jumps.list[(Zathura.Jumps.first + index) % Zathura.Jumps.size]);
+}
+
+void
+free_jumps(void)
+{
+  if(Zathura.Jumps.list)
+    free(Zathura.Jumps.list);
+
+  Zathura.Jumps.list    = NULL;
+  Zathura.Jumps.size    = 0;
+  Zathura.Jumps.first   = 0;
+  Zathura.Jumps.count   = 0;
+  Zathura.Jumps.current = 0;
+}
+
 void
 build_index(GtkTreeModel* model, GtkTreeIter* parent, PopplerIndexIter* index_iter)
 {
+  gint64 trace = TRACE_BEGIN();
+
+  /* only one level is built, the children of an entry are built when it
+   * is expanded or by the background builder */
   do
   {
     GtkTreeIter       tree_iter;
+    GtkTreeIter       placeholder;
     PopplerIndexIter *child;
     PopplerAction    *action;
     gchar            *markup;
@@ -867,39 +1457,140 @@ build_index(GtkTreeModel* model, GtkTreeIter* parent, PopplerIndexIter* index_it
     markup = g_markup_escape_text (action->any.title, -1);
 
     gtk_tree_store_append(GTK_TREE_STORE(model), &tree_iter, parent);
-    gtk_tree_store_set(GTK_TREE_STORE(model), &tree_iter, 0, markup, 1, action, -1);
+    gtk_tree_store_set(GTK_TREE_STORE(model), &tree_iter, 0, markup, 1, action, 2, NULL, -1);
     g_object_weak_ref(G_OBJECT(model), (GWeakNotify) poppler_action_free, action);
     g_free(markup);
 
     child = poppler_index_iter_get_child(index_iter);
     if(child)
-      build_index(model, &tree_iter, child);
-    poppler_index_iter_free(child);
+    {
+      gtk_tree_store_set(GTK_TREE_STORE(model), &tree_iter, 2, child, -1);
+      g_object_weak_ref(G_OBJECT(model), (GWeakNotify) poppler_index_iter_free, child);
+
+      /* empty row that makes the entry expandable */
+      gtk_tree_store_append(GTK_TREE_STORE(model), &placeholder, &tree_iter);
+      gtk_tree_store_set(GTK_TREE_STORE(model), &placeholder, 0, "", 1, NULL, 2, NULL, -1);
+
+      /* the rows of a tree store keep their iterators, unlike references
+       * they are not updated on every insert */
+      g_queue_push_tail(Zathura.Index.pending, gtk_tree_iter_copy(&tree_iter));
+    }
   } while(poppler_index_iter_next(index_iter));
+
+  TRACE_END("index", "build_index", trace);
 }
 
 void
-draw(int page_id)
+expand_index(GtkTreeModel* model, GtkTreeIter* iter)
 {
-  if(!Zathura.PDF.document || page_id < 0 || page_id >= Zathura.PDF.number_of_pages)
+  PopplerIndexIter* child;
+  GtkTreeIter       placeholder;
+
+  gtk_tree_model_get(model, iter, 2, &child, -1);
+  if(!child)
     return;
 
-  double page_width, page_height;
-  double width, height;
+  gtk_tree_store_set(GTK_TREE_STORE(model), iter, 2, NULL, -1);
+  if(gtk_tree_model_iter_children(model, &placeholder, iter))
+    gtk_tree_store_remove(GTK_TREE_STORE(model), &placeholder);
 
-  double scale = ((double) Zathura.PDF.scale / 100.0);
+  LOCK(pdflib_lock);
+  build_index(model, iter, child);
+  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+}
 
-  int rotate = Zathura.PDF.rotate;
+void
+free_index(void)
+{
+  if(Zathura.Index.builder)
+  {
+    g_source_remove(Zathura.Index.builder);
+    Zathura.Index.builder = 0;
+  }
+
+  GtkTreeIter* iter;
+  while((iter = g_queue_pop_head(Zathura.Index.pending)))
+    gtk_tree_iter_free(iter);
+}
 
-  Page *current_page = Zathura.PDF.pages[page_id];
+void
+draw(int page_id)
+{
+  if(!Zathura.PDF.document || page_id < 0 || page_id >= Zathura.PDF.number_of_pages)
+    return;
+
+  gint64 trace = TRACE_BEGIN();
 
   if(Zathura.PDF.surface)
     cairo_surface_destroy(Zathura.PDF.surface);
   Zathura.PDF.surface = NULL;
+  Zathura.Selection.active = FALSE;
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-  poppler_page_get_size(current_page->page, &page_width, &page_height);
-  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+  cairo_surface_t* surface = render_cache_lookup(page_id, Zathura.PDF.scale,
+      Zathura.PDF.rotate, Zathura.Global.recolor);
+
+  if(!surface)
+  {
+    surface = render_page(Zathura.PDF.pages[page_id]->page, Zathura.PDF.scale,
+        Zathura.PDF.rotate, Zathura.Global.recolor, TRUE);
+    render_cache_insert(page_id, Zathura.PDF.scale, Zathura.PDF.rotate,
+        Zathura.Global.recolor, surface);
+  }
+
+  /* the cached page is shown as it is until something is drawn on it */
+  Zathura.PDF.surface        = surface;
+  Zathura.PDF.surface_shared = TRUE;
+
+  int width  = cairo_image_surface_get_width(surface);
+  int height = cairo_image_surface_get_height(surface);
+
+  gtk_widget_set_size_request(Zathura.UI.drawing_area, width, height);
+  gtk_widget_queue_draw(Zathura.UI.drawing_area);
+
+  update_pinned_pages();
+  prefetch_links_of_page(page_id);
+
+  TRACE_END("render", "draw", trace);
+}
+
+cairo_t*
+create_page_context(void)
+{
+  /* the page is still shared with the render cache, so highlights are drawn
+   * on a copy of it */
+  if(Zathura.PDF.surface_shared)
+  {
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+        cairo_image_surface_get_width(Zathura.PDF.surface),
+        cairo_image_surface_get_height(Zathura.PDF.surface));
+
+    cairo_t* cairo = cairo_create(surface);
+    cairo_set_source_surface(cairo, Zathura.PDF.surface, 0, 0);
+    cairo_paint(cairo);
+    cairo_destroy(cairo);
+
+    cairo_surface_destroy(Zathura.PDF.surface);
+    Zathura.PDF.surface        = surface;
+    Zathura.PDF.surface_shared = FALSE;
+  }
+
+  return cairo_create(Zathura.PDF.surface);
+}
+
+cairo_surface_t*
+render_page(PopplerPage* page, int page_scale, int rotate, gboolean recolor, gboolean lock)
+{
+  double page_width, page_height;
+  double width, height;
+
+  double scale = ((double) page_scale / 100.0);
+
+  /* pages of a document that is not shared need no locking */
+  if(lock)
+    LOCK(pdflib_lock);
+  poppler_page_get_size(page, &page_width, &page_height);
+  if(lock)
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
   if(rotate == 0 || rotate == 180)
   {
@@ -913,8 +1604,8 @@ draw(int page_id)
   }
 
   cairo_t *cairo;
-  Zathura.PDF.surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
-  cairo = cairo_create(Zathura.PDF.surface);
+  cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+  cairo = cairo_create(surface);
 
   cairo_save(cairo);
   cairo_set_source_rgb(cairo, 1, 1, 1);
@@ -944,21 +1635,29 @@ draw(int page_id)
   if(rotate != 0)
     cairo_rotate(cairo, rotate * G_PI / 180.0);
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-  poppler_page_render(current_page->page, cairo);
-  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+  gint64 trace = TRACE_BEGIN();
+
+  if(lock)
+    LOCK(pdflib_lock);
+  poppler_page_render(page, cairo);
+  if(lock)
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+  TRACE_END("render", "render", trace);
 
   cairo_restore(cairo);
   cairo_destroy(cairo);
 
-  if(Zathura.Global.recolor)
+  if(recolor && cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS)
   {
-    unsigned char* image = cairo_image_surface_get_data(Zathura.PDF.surface);
+    trace = TRACE_BEGIN();
+
+    unsigned char* image = cairo_image_surface_get_data(surface);
     int x, y;
 
-    int width     = cairo_image_surface_get_width(Zathura.PDF.surface);
-    int height    = cairo_image_surface_get_height(Zathura.PDF.surface);
-    int rowstride = cairo_image_surface_get_stride(Zathura.PDF.surface);
+    int width     = cairo_image_surface_get_width(surface);
+    int height    = cairo_image_surface_get_height(surface);
+    int rowstride = cairo_image_surface_get_stride(surface);
 
     /* recolor code based on qimageblitz library flatten() function
     (http://sourceforge.net/projects/qimageblitz/) */
@@ -991,66 +1690,342 @@ draw(int page_id)
         data += 4;
       }
     }
+
+    TRACE_END("render", "recolor", trace);
   }
 
-  gtk_widget_set_size_request(Zathura.UI.drawing_area, width, height);
-  gtk_widget_queue_draw(Zathura.UI.drawing_area);
+  return surface;
 }
 
-void
-change_mode(int mode)
+cairo_surface_t*
+render_cache_lookup(int page_id, int scale, int rotate, gboolean recolor)
 {
-  char* mode_text = 0;
-  for(unsigned int i = 0; i != LENGTH(mode_names); ++i)
-    if(mode_names[i].mode == mode)
+  cairo_surface_t* surface = NULL;
+
+  LOCK(render_lock);
+  GList* list;
+  for(list = Zathura.Render.pinned; list; list = g_list_next(list))
+  {
+    RenderCacheEntry* entry = (RenderCacheEntry*) list->data;
+    if(entry->surface && entry->page_id == page_id && entry->scale == scale &&
+        entry->rotate == rotate && entry->recolor == recolor)
     {
-      mode_text = mode_names[i].display;
-      break;
+      surface = cairo_surface_reference(entry->surface);
+      g_static_mutex_unlock(&(Zathura.Lock.render_lock));
+      return surface;
     }
+  }
 
-  if(!mode_text)
+  for(list = Zathura.Render.cache->head; list; list = g_list_next(list))
   {
-    switch(mode)
+    RenderCacheEntry* entry = (RenderCacheEntry*) list->data;
+    if(entry->page_id == page_id && entry->scale == scale &&
+        entry->rotate == rotate && entry->recolor == recolor)
     {
-      case ADD_MARKER:
-        mode_text = "";
-        break;
-      case EVAL_MARKER:
-        mode_text = "";
-        break;
-      default:
-        mode_text = "";
-        mode      = NORMAL;
-        break;
+      /* move to the front, the last entry is evicted first */
+      g_queue_unlink(Zathura.Render.cache, list);
+      g_queue_push_head_link(Zathura.Render.cache, list);
+      surface = cairo_surface_reference(entry->surface);
+      break;
     }
   }
+  g_static_mutex_unlock(&(Zathura.Lock.render_lock));
 
-  Zathura.Global.mode = mode;
-  notify(DEFAULT, mode_text);
+  return surface;
 }
 
 void
-calculate_offset(GtkWidget* widget, double* offset_x, double* offset_y)
+render_cache_insert(int page_id, int scale, int rotate, gboolean recolor, cairo_surface_t* surface)
 {
-  double page_width, page_height, width, height;
-  double scale = ((double) Zathura.PDF.scale / 100.0);
+  if(render_cache_size <= 0)
+    return;
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-  poppler_page_get_size(Zathura.PDF.pages[Zathura.PDF.page_number]->page, &page_width, &page_height);
-  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+  RenderCacheEntry* entry = malloc(sizeof(RenderCacheEntry));
+  if(!entry)
+    out_of_memory();
 
-  if(Zathura.PDF.rotate == 0 || Zathura.PDF.rotate == 180)
+  entry->page_id = page_id;
+  entry->scale   = scale;
+  entry->rotate  = rotate;
+  entry->recolor = recolor;
+  entry->surface = cairo_surface_reference(surface);
+
+  LOCK(render_lock);
+  g_queue_push_head(Zathura.Render.cache, entry);
+
+  while((int) Zathura.Render.cache->length > render_cache_size)
   {
-    width  = page_width  * scale;
-    height = page_height * scale;
+    RenderCacheEntry* old_entry = g_queue_pop_tail(Zathura.Render.cache);
+    cairo_surface_destroy(old_entry->surface);
+    free(old_entry);
   }
-  else
+  g_static_mutex_unlock(&(Zathura.Lock.render_lock));
+}
+
+void
+render_cache_clear(void)
+{
+  LOCK(render_lock);
+  RenderCacheEntry* entry;
+  while((entry = g_queue_pop_head(Zathura.Render.cache)))
   {
-    width  = page_height * scale;
-    height = page_width  * scale;
+    cairo_surface_destroy(entry->surface);
+    free(entry);
   }
 
-  int window_x, window_y;
+  GList* list;
+  for(list = Zathura.Render.pinned; list; list = g_list_next(list))
+  {
+    entry = (RenderCacheEntry*) list->data;
+    if(entry->surface)
+      cairo_surface_destroy(entry->surface);
+    free(entry);
+  }
+
+  g_list_free(Zathura.Render.pinned);
+  Zathura.Render.pinned = NULL;
+  g_static_mutex_unlock(&(Zathura.Lock.render_lock));
+}
+
+void
+render_cache_pin(int page_id, int scale, int rotate, gboolean recolor, cairo_surface_t* surface)
+{
+  LOCK(render_lock);
+  GList* list;
+  for(list = Zathura.Render.pinned; list; list = g_list_next(list))
+  {
+    RenderCacheEntry* entry = (RenderCacheEntry*) list->data;
+    if(!entry->surface && entry->page_id == page_id && entry->scale == scale &&
+        entry->rotate == rotate && entry->recolor == recolor)
+    {
+      entry->surface = cairo_surface_reference(surface);
+      break;
+    }
+  }
+  g_static_mutex_unlock(&(Zathura.Lock.render_lock));
+}
+
+void
+update_pinned_pages(void)
+{
+  if(!Zathura.Render.pool)
+    return;
+
+  /* the pages that should be pinned: the last position, the most recent
+   * jumps and the markers at the current scale and the bookmarks at their
+   * own scale */
+  int number_of_pages = 0;
+  int number_of_jumps = MAX(MIN(jumplist_pinned, Zathura.Jumps.count), 0);
+  int* pages  = g_malloc(sizeof(int) * (MAX(pinned_cache_size, 0) + 1));
+  int* scales = g_malloc(sizeof(int) * (MAX(pinned_cache_size, 0) + 1));
+
+  int i, j;
+  for(i = -1; i < number_of_jumps + Zathura.Marker.number_of_markers + Zathura.Bookmarks.number_of_bookmarks
+      && number_of_pages < pinned_cache_size; i++)
+  {
+    int page, scale;
+    if(i < 0)
+    {
+      page  = Zathura.Marker.last;
+      scale = Zathura.PDF.scale;
+    }
+    else if(i < number_of_jumps)
+    {
+      page  = get_jump(Zathura.Jumps.count - i - 1)->page;
+      scale = Zathura.PDF.scale;
+    }
+    else if(i < number_of_jumps + Zathura.Marker.number_of_markers)
+    {
+      page  = Zathura.Marker.markers[i - number_of_jumps].page;
+      scale = Zathura.PDF.scale;
+    }
+    else
+    {
+      int b = i - number_of_jumps - Zathura.Marker.number_of_markers;
+      page  = Zathura.Bookmarks.bookmarks[b].page;
+      scale = Zathura.Bookmarks.bookmarks[b].scale;
+    }
+
+    if(page < 0 || page >= Zathura.PDF.number_of_pages)
+      continue;
+
+    for(j = 0; j < number_of_pages; j++)
+      if(pages[j] == page && scales[j] == scale)
+        break;
+
+    if(j == number_of_pages)
+    {
+      pages[number_of_pages]  = page;
+      scales[number_of_pages] = scale;
+      number_of_pages++;
+    }
+  }
+
+  LOCK(render_lock);
+
+  /* drop entries that are no longer needed, e.g. after zooming */
+  GList* list = Zathura.Render.pinned;
+  while(list)
+  {
+    GList* next = g_list_next(list);
+    RenderCacheEntry* entry = (RenderCacheEntry*) list->data;
+
+    for(j = 0; j < number_of_pages; j++)
+      if(entry->page_id == pages[j] && entry->scale == scales[j])
+        break;
+
+    if(j == number_of_pages || entry->rotate != Zathura.PDF.rotate || entry->recolor != Zathura.Global.recolor)
+    {
+      if(entry->surface)
+        cairo_surface_destroy(entry->surface);
+      free(entry);
+      Zathura.Render.pinned = g_list_delete_link(Zathura.Render.pinned, list);
+    }
+
+    list = next;
+  }
+
+  /* render the missing ones in the background */
+  for(i = 0; i < number_of_pages; i++)
+  {
+    for(list = Zathura.Render.pinned; list; list = g_list_next(list))
+    {
+      RenderCacheEntry* entry = (RenderCacheEntry*) list->data;
+      if(entry->page_id == pages[i] && entry->scale == scales[i])
+        break;
+    }
+
+    if(list)
+      continue;
+
+    RenderCacheEntry* entry = malloc(sizeof(RenderCacheEntry));
+    RenderJob* job          = malloc(sizeof(RenderJob));
+    if(!entry || !job)
+      out_of_memory();
+
+    entry->page_id = job->page_id = pages[i];
+    entry->scale   = job->scale   = scales[i];
+    entry->rotate  = job->rotate  = Zathura.PDF.rotate;
+    entry->recolor = job->recolor = Zathura.Global.recolor;
+    entry->surface = NULL;
+    job->priority  = 0;
+    job->pin       = TRUE;
+
+    Zathura.Render.pinned = g_list_prepend(Zathura.Render.pinned, entry);
+    g_thread_pool_push(Zathura.Render.pool, job, NULL);
+  }
+
+  g_static_mutex_unlock(&(Zathura.Lock.render_lock));
+
+  g_free(pages);
+  g_free(scales);
+}
+
+void
+prefetch_links_of_page(int page_id)
+{
+  if(!Zathura.Render.pool || prefetch_links <= 0)
+    return;
+
+  PageLinks* links = get_page_links(page_id);
+  GList* queued    = NULL;
+  int number_of_jobs = 0;
+
+  int i;
+  for(i = 0; i < links->number_of_links && number_of_jobs < prefetch_links; i++)
+  {
+    PopplerAction* action = links->links[i].action;
+    if(action->type != POPPLER_ACTION_GOTO_DEST)
+      continue;
+
+    /* do not ask poppler for named destinations before the scan finished */
+    if(action->goto_dest.dest->type == POPPLER_DEST_NAMED &&
+        !g_atomic_pointer_get(&Zathura.PDF.destinations))
+      continue;
+
+    int target = find_dest_page(action->goto_dest.dest) - 1;
+    if(target < 0 || target >= Zathura.PDF.number_of_pages || target == page_id
+        || g_list_find(queued, GINT_TO_POINTER(target)))
+      continue;
+
+    queued = g_list_prepend(queued, GINT_TO_POINTER(target));
+    number_of_jobs++;
+
+    RenderJob* job = malloc(sizeof(RenderJob));
+    if(!job)
+      out_of_memory();
+
+    job->page_id  = target;
+    job->scale    = Zathura.PDF.scale;
+    job->rotate   = Zathura.PDF.rotate;
+    job->recolor  = Zathura.Global.recolor;
+    job->priority = 1;
+    job->pin      = FALSE;
+
+    g_thread_pool_push(Zathura.Render.pool, job, NULL);
+  }
+
+  g_list_free(queued);
+}
+
+gint
+compare_render_jobs(gconstpointer a, gconstpointer b, gpointer data)
+{
+  return ((const RenderJob*) a)->priority - ((const RenderJob*) b)->priority;
+}
+
+void
+change_mode(int mode)
+{
+  char* mode_text = 0;
+  for(unsigned int i = 0; i != LENGTH(mode_names); ++i)
+    if(mode_names[i].mode == mode)
+    {
+      mode_text = mode_names[i].display;
+      break;
+    }
+
+  if(!mode_text)
+  {
+    switch(mode)
+    {
+      case ADD_MARKER:
+        mode_text = "";
+        break;
+      case EVAL_MARKER:
+        mode_text = "";
+        break;
+      default:
+        mode_text = "";
+        mode      = NORMAL;
+        break;
+    }
+  }
+
+  Zathura.Global.mode = mode;
+  notify(DEFAULT, mode_text);
+}
+
+void
+calculate_offset(GtkWidget* widget, double* offset_x, double* offset_y)
+{
+  double page_width, page_height, width, height;
+  double scale = ((double) Zathura.PDF.scale / 100.0);
+
+  get_page_size(Zathura.PDF.page_number, &page_width, &page_height);
+
+  if(Zathura.PDF.rotate == 0 || Zathura.PDF.rotate == 180)
+  {
+    width  = page_width  * scale;
+    height = page_height * scale;
+  }
+  else
+  {
+    width  = page_height * scale;
+    height = page_width  * scale;
+  }
+
+  int window_x, window_y;
   gdk_drawable_get_size(widget->window, &window_x, &window_y);
 
   if (window_x > width)
@@ -1070,43 +2045,65 @@ close_file(gboolean keep_monitor)
   if(!Zathura.PDF.document)
     return;
 
+  /* stop rendering in the background */
+  if(Zathura.Render.pool)
+  {
+    LOCK(render_lock);
+    Zathura.Render.stop = TRUE;
+    g_static_mutex_unlock(&(Zathura.Lock.render_lock));
+
+    g_thread_pool_free(Zathura.Render.pool, FALSE, TRUE);
+    Zathura.Render.pool = NULL;
+    Zathura.Render.stop = FALSE;
+  }
+  render_cache_clear();
+
+  /* stop scanning the document */
+  if(Zathura.Thread.scan_thread)
+  {
+    LOCK(search_lock);
+    Zathura.Thread.scan_thread_running = FALSE;
+    g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+    g_thread_join(Zathura.Thread.scan_thread);
+    Zathura.Thread.scan_thread = NULL;
+  }
+
+  GHashTable* destinations = g_atomic_pointer_get(&Zathura.PDF.destinations);
+  if(destinations)
+  {
+    g_atomic_pointer_set(&Zathura.PDF.destinations, NULL);
+    g_hash_table_destroy(destinations);
+  }
+
+  free_sections(g_atomic_pointer_get(&Zathura.PDF.sections));
+  g_atomic_pointer_set(&Zathura.PDF.sections, NULL);
+
   /* clean up pages */
   int i;
   for(i = 0; i < Zathura.PDF.number_of_pages; i++)
   {
     Page* current_page = Zathura.PDF.pages[i];
+    free_page_links(current_page->links);
+    free_page_text_layout(current_page->text);
     g_object_unref(current_page->page);
     if(current_page->label)
       g_free(current_page->label);
     free(current_page);
   }
 
-  /* save bookmarks */
-  if(Zathura.Bookmarks.data)
+  /* save position */
+  store_position();
+  if(Zathura.Bookmarks.idle_save)
   {
-    read_bookmarks_file();
-
-    if(save_position)
-    {
-      /* set current page */
-      g_key_file_set_integer(Zathura.Bookmarks.data, Zathura.PDF.file,
-          bm_reserved_names[BM_PAGE_ENTRY], Zathura.PDF.page_number);
-
-      /* set page offset */
-      g_key_file_set_integer(Zathura.Bookmarks.data, Zathura.PDF.file,
-          bm_reserved_names[BM_PAGE_OFFSET], Zathura.PDF.page_offset);
-    }
-
-    if (save_zoom_level)
-    {
-      /* set zoom level */
-      g_key_file_set_integer(Zathura.Bookmarks.data, Zathura.PDF.file,
-          bm_reserved_names[BM_PAGE_SCALE], Zathura.PDF.scale);
-    }
-
-    write_bookmarks_file();
-    free_bookmarks();
+    g_source_remove(Zathura.Bookmarks.idle_save);
+    Zathura.Bookmarks.idle_save = 0;
   }
+  g_free(Zathura.Bookmarks.last_position);
+  Zathura.Bookmarks.last_position = NULL;
+
+  free_bookmarks();
+  compact_bookmarks_file();
 
   /* inotify */
   if(!keep_monitor)
@@ -1131,7 +2128,7 @@ close_file(gboolean keep_monitor)
   g_free(Zathura.State.filename);
   Zathura.State.filename      = g_strdup((char*) default_text);
 
-  g_static_mutex_lock(&(Zathura.Lock.pdf_obj_lock));
+  LOCK(pdf_obj_lock);
   Zathura.PDF.document        = NULL;
 
   if(!keep_monitor)
@@ -1149,6 +2146,7 @@ close_file(gboolean keep_monitor)
   g_static_mutex_unlock(&(Zathura.Lock.pdf_obj_lock));
 
   /* destroy index */
+  free_index();
   if(Zathura.UI.index)
   {
     gtk_widget_destroy(Zathura.UI.index);
@@ -1168,6 +2166,9 @@ close_file(gboolean keep_monitor)
   Zathura.Marker.number_of_markers =  0;
   Zathura.Marker.last              = -1;
 
+  /* free jump history */
+  free_jumps();
+
   update_status();
 }
 
@@ -1190,6 +2191,7 @@ eval_marker(int id)
   if(id == 0x27)
   {
     int current_page = Zathura.PDF.page_number;
+    add_jump();
     set_page(Zathura.Marker.last);
     Zathura.Marker.last = current_page;
     return;
@@ -1201,6 +2203,7 @@ eval_marker(int id)
   {
     if(Zathura.Marker.markers[i].id == id)
     {
+      add_jump();
       set_page(Zathura.Marker.markers[i].page);
       restore_page_position(&Zathura.Marker.markers[i].position);
       return;
@@ -1212,7 +2215,7 @@ void
 highlight_result(int page_id, PopplerRectangle* rectangle)
 {
   PopplerRectangle* trect = poppler_rectangle_copy(rectangle);
-  cairo_t *cairo = cairo_create(Zathura.PDF.surface);
+  cairo_t *cairo = create_page_context();
   cairo_set_source_rgba(cairo, Zathura.Style.search_highlight.red, Zathura.Style.search_highlight.green,
       Zathura.Style.search_highlight.blue, transparency);
 
@@ -1249,7 +2252,10 @@ notify(int level, const char* message)
 gboolean
 open_file(char* path, char* password)
 {
-  g_static_mutex_lock(&(Zathura.Lock.pdf_obj_lock));
+  /* documents that fail to open are not traced */
+  gint64 trace = TRACE_BEGIN();
+
+  LOCK(pdf_obj_lock);
 
   /* specify path max */
   size_t pm;
@@ -1298,7 +2304,7 @@ open_file(char* path, char* password)
   /* close old file */
   g_static_mutex_unlock(&(Zathura.Lock.pdf_obj_lock));
   close_file(FALSE);
-  g_static_mutex_lock(&(Zathura.Lock.pdf_obj_lock));
+  LOCK(pdf_obj_lock);
 
   /* format path */
   GError* error = NULL;
@@ -1316,9 +2322,11 @@ open_file(char* path, char* password)
   }
 
   /* open file */
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+  gint64 trace_load = TRACE_BEGIN();
+  LOCK(pdflib_lock);
   Zathura.PDF.document = poppler_document_new_from_file(file_uri, password, &error);
   g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+  TRACE_END("open", "load", trace_load);
 
   if(!Zathura.PDF.document)
   {
@@ -1363,7 +2371,7 @@ open_file(char* path, char* password)
 
   g_free(file_uri);
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+  LOCK(pdflib_lock);
   Zathura.PDF.number_of_pages = poppler_document_get_n_pages(Zathura.PDF.document);
   g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
   g_free(Zathura.PDF.file);
@@ -1379,7 +2387,8 @@ open_file(char* path, char* password)
     out_of_memory();
 
   /* get pages and check label mode */
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+  gint64 trace_pages = TRACE_BEGIN();
+  LOCK(pdflib_lock);
   Zathura.Global.enable_labelmode = FALSE;
 
   int i;
@@ -1390,6 +2399,10 @@ open_file(char* path, char* password)
       out_of_memory();
 
     Zathura.PDF.pages[i]->id = i + 1;
+    Zathura.PDF.pages[i]->links  = NULL;
+    Zathura.PDF.pages[i]->text   = NULL;
+    Zathura.PDF.pages[i]->width  = 0;
+    Zathura.PDF.pages[i]->height = 0;
     Zathura.PDF.pages[i]->page = poppler_document_get_page(Zathura.PDF.document, i);
     g_object_get(G_OBJECT(Zathura.PDF.pages[i]->page), "label", &(Zathura.PDF.pages[i]->label), NULL);
 
@@ -1399,107 +2412,73 @@ open_file(char* path, char* password)
       Zathura.Global.enable_labelmode = TRUE;
   }
   g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+  TRACE_END("open", "pages", trace_pages);
 
   /* set correct goto mode */
   if(!Zathura.Global.enable_labelmode && GOTO_MODE == GOTO_LABELS)
     Zathura.Global.goto_mode = GOTO_DEFAULT;
 
   /* start page */
-  int start_page          = 0;
-  Zathura.PDF.page_offset = 0;
+  int start_page              = 0;
+  PagePosition start_position = { 0, 0 };
+  Zathura.PDF.page_offset     = 0;
 
   /* bookmarks */
-  if(Zathura.Bookmarks.data && g_key_file_has_group(Zathura.Bookmarks.data, file))
-  {
-    /* get last opened page */
-    if(save_position && g_key_file_has_key(Zathura.Bookmarks.data, file,
-        bm_reserved_names[BM_PAGE_ENTRY], NULL))
-      start_page = g_key_file_get_integer(Zathura.Bookmarks.data, file,
-          bm_reserved_names[BM_PAGE_ENTRY], NULL);
-
-    /* get page offset */
-    if(save_position && g_key_file_has_key(Zathura.Bookmarks.data, file,
-        bm_reserved_names[BM_PAGE_OFFSET], NULL))
-      Zathura.PDF.page_offset = g_key_file_get_integer(Zathura.Bookmarks.data, file,
-          bm_reserved_names[BM_PAGE_OFFSET], NULL);
+  read_bookmarks_file();
+
+  /* the writer thread updates the index after a compaction */
+  LOCK(bookmarks_lock);
+  BookmarkRecord* record = g_hash_table_lookup(Zathura.Bookmarks.documents, file);
+  if(record)
+  {
+    /* get last opened page and page offset */
+    if(save_position && record->has_position)
+    {
+      start_page              = record->page;
+      Zathura.PDF.page_offset = record->offset;
+      start_position          = record->position;
+    }
     if((Zathura.PDF.page_offset != 0) && (Zathura.PDF.page_offset != GOTO_OFFSET))
       Zathura.PDF.page_offset = GOTO_OFFSET;
 
     /* get zoom level */
-    if (save_zoom_level && g_key_file_has_key(Zathura.Bookmarks.data, file,
-        bm_reserved_names[BM_PAGE_SCALE], NULL))
+    if(save_zoom_level && record->has_position && record->scale > 0)
     {
-      Zathura.PDF.scale = g_key_file_get_integer(Zathura.Bookmarks.data, file,
-          bm_reserved_names[BM_PAGE_SCALE], NULL);
+      Zathura.PDF.scale = record->scale;
       Zathura.Global.adjust_mode = ADJUST_NONE;
     }
     if (Zathura.PDF.scale > zoom_max)
       Zathura.PDF.scale = zoom_max;
     if (Zathura.PDF.scale < zoom_min)
       Zathura.PDF.scale = zoom_min;
+  }
+  g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
 
-    /* open and read bookmark file */
-    gsize i              = 0;
-    gsize number_of_keys = 0;
-    char** keys          = g_key_file_get_keys(Zathura.Bookmarks.data, file, &number_of_keys, NULL);
-    Bookmark* bmarks;
-
-    for(i = 0; i < number_of_keys; i++)
-    {
-      if(!is_reserved_bm_name(keys[i]))
-      {
-        int next = Zathura.Bookmarks.number_of_bookmarks;
-        Zathura.Bookmarks.bookmarks = realloc(Zathura.Bookmarks.bookmarks,
-            (next + 1) * sizeof(Bookmark));
-
-        bmarks = Zathura.Bookmarks.bookmarks;
-        bmarks[next].id   = g_strdup(keys[i]);
-        bmarks[next].page =
-          g_key_file_get_integer(Zathura.Bookmarks.data, file, keys[i], NULL);
-
-        position_bookmark(&bmarks[next], file, keys[i]);
+  load_bookmarks(file);
 
-        Zathura.Bookmarks.number_of_bookmarks++;
-      }
-    }
+  /* render link targets in the background */
+  Zathura.Render.pool = g_thread_pool_new(render_job, NULL, 1, FALSE, NULL);
+  if(Zathura.Render.pool)
+    g_thread_pool_set_sort_function(Zathura.Render.pool, compare_render_jobs, NULL);
 
-    g_strfreev(keys);
-  }
+  /* resolve named destinations in the background */
+  Zathura.Thread.scan_thread_running = TRUE;
+  Zathura.Thread.scan_thread = g_thread_create(scan_document, (gpointer) Zathura.PDF.document, TRUE, NULL);
 
   /* set window title */
   gtk_window_set_title(GTK_WINDOW(Zathura.UI.window), basename(file));
 
   /* show document */
   set_page(start_page);
+  if(start_position.x > 0 || start_position.y > 0)
+    restore_page_position(&start_position);
   update_status();
 
   g_static_mutex_unlock(&(Zathura.Lock.pdf_obj_lock));
   isc_abort(NULL);
-  return TRUE;
-}
 
-void
-position_bookmark(Bookmark* bmark, const gchar* file, const gchar* key)
-{
-  bmark->scale      = Zathura.PDF.scale;
-  bmark->position.x = 0;
-  bmark->position.y = 0;
-
-  char* section = g_strdup_printf("%s#positions", file);
-  gsize length = 3;
-  if(g_key_file_has_group(Zathura.Bookmarks.data, section))
-  {
-    gint* location = g_key_file_get_integer_list(Zathura.Bookmarks.data,
-                                                 section, key, &length, NULL);
-    if(location)
-    {
-      bmark->scale      = location[0];
-      bmark->position.x = location[1];
-      bmark->position.y = location[2];
-      g_free(location);
-    }
-  }
-  g_free(section);
+  TRACE_END("open", "open_file", trace);
+  return TRUE;
 }
 
 gboolean
@@ -1571,22 +2550,134 @@ void open_uri(char* uri)
 {
   char* escaped_uri = g_shell_quote(uri);
   char* uri_cmd = g_strdup_printf(uri_command, escaped_uri);
-  system(uri_cmd);
+  spawn_command(uri_cmd, "Opening URI", FALSE);
   g_free(uri_cmd);
   g_free(escaped_uri);
 }
 
+gboolean
+spawn_command(char* command, const char* description, gboolean report_success)
+{
+  gchar* argv[] = { "/bin/sh", "-c", command, NULL };
+  GPid   pid;
+  GError* error = NULL;
+
+  /* run it without waiting; the exit status is reported by cb_child_exited */
+  if(!g_spawn_async(NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &pid, &error))
+  {
+    gchar* message = g_strdup_printf("%s failed: %s", description, error->message);
+    notify(ERROR, message);
+    g_free(message);
+    g_error_free(error);
+    return FALSE;
+  }
+
+  ChildProcess* child = malloc(sizeof(ChildProcess));
+  if(!child)
+    out_of_memory();
+
+  child->description    = g_strdup(description);
+  child->report_success = report_success;
+
+  g_child_watch_add(pid, cb_child_exited, child);
+
+  return TRUE;
+}
+
 void out_of_memory(void)
 {
   printf("error: out of memory\n");
   exit(-1);
 }
 
+void
+trace_event(const char* category, const char* name, gint64 start)
+{
+  gint64 end = g_get_monotonic_time();
+
+#ifdef __linux__
+  unsigned int thread = syscall(SYS_gettid);
+#else
+  unsigned int thread = GPOINTER_TO_UINT(g_thread_self());
+#endif
+
+  g_static_mutex_lock(&(Zathura.Lock.trace_lock));
+
+  /* the trace is never reopened once it was finished, which would truncate it */
+  if(!Zathura.Trace.file && !Zathura.Trace.closed && Zathura.Config.data_dir)
+  {
+    gchar* trace_file = g_strdup_printf(TRACE_FILE, (int) getpid());
+    gchar* file       = g_build_filename(Zathura.Config.data_dir, trace_file, NULL);
+
+    Zathura.Trace.file = fopen(file, "w");
+    if(Zathura.Trace.file)
+      fputs("[\n", Zathura.Trace.file);
+    else
+    {
+      fprintf(stderr, "error: could not write trace to %s\n", file);
+      Zathura.Trace.enabled = FALSE;
+    }
+
+    g_free(trace_file);
+    g_free(file);
+  }
+
+  /* complete events in the trace event format of chrome://tracing */
+  if(Zathura.Trace.file)
+  {
+    fprintf(Zathura.Trace.file, "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+        "\"ts\": %" G_GINT64_FORMAT ", \"dur\": %" G_GINT64_FORMAT ", \"pid\": %i, \"tid\": %u}",
+        Zathura.Trace.events ? ",\n" : "", name, category, start, end - start, (int) getpid(), thread);
+    Zathura.Trace.events++;
+  }
+
+  g_static_mutex_unlock(&(Zathura.Lock.trace_lock));
+}
+
+void
+trace_lock(GStaticMutex* mutex, const char* name)
+{
+  /* only the time spent waiting for the lock is recorded */
+  if(g_static_mutex_trylock(mutex))
+    return;
+
+  gint64 start = g_get_monotonic_time();
+  g_static_mutex_lock(mutex);
+  trace_event("lock", name, start);
+}
+
+void
+close_trace(void)
+{
+  g_static_mutex_lock(&(Zathura.Lock.trace_lock));
+
+  if(Zathura.Trace.file)
+  {
+    fputs("\n]\n", Zathura.Trace.file);
+    fclose(Zathura.Trace.file);
+    Zathura.Trace.file = NULL;
+  }
+
+  Zathura.Trace.enabled = FALSE;
+  Zathura.Trace.closed  = TRUE;
+
+  g_static_mutex_unlock(&(Zathura.Lock.trace_lock));
+}
+
 void
 update_status(void)
 {
   /* update text */
-  gtk_label_set_markup((GtkLabel*) Zathura.Global.status_text, Zathura.State.filename);
+  update_status_text();
+
+  /* save the position once the view has not changed for a while; a single
+   * timer checks the time of the last change instead of being re-added */
+  if(Zathura.PDF.document && autosave_idle > 0)
+  {
+    Zathura.Bookmarks.last_activity = g_get_monotonic_time();
+    if(!Zathura.Bookmarks.idle_save)
+      Zathura.Bookmarks.idle_save = gdk_threads_add_timeout_seconds(autosave_idle, cb_idle_save, NULL);
+  }
 
   /* update pages */
   if( Zathura.PDF.document && Zathura.PDF.pages )
@@ -1601,7 +2692,9 @@ update_status(void)
   char* zoom_level  = (Zathura.PDF.scale != 0) ? g_strdup_printf("%d%%", Zathura.PDF.scale) : g_strdup("");
   char* goto_mode   = (Zathura.Global.goto_mode == GOTO_LABELS) ? "L" :
     (Zathura.Global.goto_mode == GOTO_OFFSET) ? "O" : "D";
-  char* status_text = g_strdup_printf("%s [%s] %s (%d%%)", zoom_level, goto_mode, Zathura.State.pages, Zathura.State.scroll_percentage);
+  const char* section = (Zathura.PDF.document && show_section) ? get_section_title(Zathura.PDF.page_number) : NULL;
+  char* status_text = g_strdup_printf("%s%s%s [%s] %s (%d%%)", section ? section : "", section ? "  " : "",
+      zoom_level, goto_mode, Zathura.State.pages, Zathura.State.scroll_percentage);
   gtk_label_set_markup((GtkLabel*) Zathura.Global.status_state, status_text);
   g_free(status_text);
   g_free(zoom_level);
@@ -1610,64 +2703,369 @@ update_status(void)
 void
 read_bookmarks_file(void)
 {
-  /* free it at first */
-  if (Zathura.Bookmarks.data)
-    g_key_file_free(Zathura.Bookmarks.data);
+  struct stat info;
+  if(stat(Zathura.Bookmarks.file, &info) != 0)
+    return;
+
+  LOCK(bookmarks_lock);
 
-  /* create or open existing bookmark file */
-  Zathura.Bookmarks.data = g_key_file_new();
-  if(!g_file_test(Zathura.Bookmarks.file, G_FILE_TEST_IS_REGULAR))
+  /* the file was compacted by another instance */
+  if(info.st_ino != Zathura.Bookmarks.inode || info.st_size < Zathura.Bookmarks.offset)
   {
-    /* file does not exist */
-    g_file_set_contents(Zathura.Bookmarks.file, "# Zathura bookmarks (escherdragon fork)\n", -1, NULL);
+    g_hash_table_remove_all(Zathura.Bookmarks.documents);
+    Zathura.Bookmarks.inode   = info.st_ino;
+    Zathura.Bookmarks.offset  = 0;
+    Zathura.Bookmarks.records = 0;
   }
 
-  GError* error = NULL;
-  if(!g_key_file_load_from_file(Zathura.Bookmarks.data, Zathura.Bookmarks.file,
-        G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS, &error))
+  /* only read the records that were appended since the last time */
+  if(info.st_size > Zathura.Bookmarks.offset)
   {
-    gchar* message = g_strdup_printf("Could not load bookmark file: %s", error->message);
-    notify(ERROR, message);
-    g_free(message);
-  }
-}
+    size_t length = info.st_size - Zathura.Bookmarks.offset;
+    char* buffer  = g_malloc(length + 1);
+    int fd        = open(Zathura.Bookmarks.file, O_RDONLY);
+    ssize_t bytes = -1;
 
-void
-write_bookmarks_file(void)
-{
-  if (!Zathura.Bookmarks.data)
-    /* nothing to do */
-    return;
+    if(fd != -1)
+    {
+      if(lseek(fd, Zathura.Bookmarks.offset, SEEK_SET) != -1)
+        bytes = read(fd, buffer, length);
+      close(fd);
+    }
 
-  /* save bookmarks */
-  Bookmark bm;
-  gsize location_length = 3;
-  gint* location = malloc(sizeof(gint) * location_length);
-  char* master_section = g_strdup(Zathura.PDF.file);
-  char* positions_section = g_strdup_printf("%s#positions", master_section);
+    if(bytes > 0)
+    {
+      buffer[bytes] = '\0';
 
-  for(int i = 0; i < Zathura.Bookmarks.number_of_bookmarks; i++)
+      /* records that are still being written are read next time */
+      char* line = buffer;
+      char* end;
+      while((end = strchr(line, '\n')))
+      {
+        *end = '\0';
+        apply_bookmark_record(line);
+        Zathura.Bookmarks.records++;
+        line = end + 1;
+      }
+
+      Zathura.Bookmarks.offset += line - buffer;
+    }
+
+    g_free(buffer);
+
+    /* records that are not written yet are newer than the file */
+    GList* list;
+    for(list = Zathura.Bookmarks.writing; list; list = g_list_next(list))
+    {
+      gchar* line = g_strndup(list->data, strlen(list->data) - 1);
+      apply_bookmark_record(line);
+      g_free(line);
+    }
+    for(list = Zathura.Bookmarks.queue->head; list; list = g_list_next(list))
+    {
+      gchar* line = g_strndup(list->data, strlen(list->data) - 1);
+      apply_bookmark_record(line);
+      g_free(line);
+    }
+  }
+
+  g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+}
+
+void
+migrate_bookmarks_file(const char* old_file)
+{
+  GKeyFile* data = g_key_file_new();
+  if(!g_key_file_load_from_file(data, old_file, G_KEY_FILE_NONE, NULL))
+  {
+    g_key_file_free(data);
+    return;
+  }
+
+  GString* records = g_string_new("");
+  gchar** groups   = g_key_file_get_groups(data, NULL);
+
+  int i;
+  for(i = 0; groups[i]; i++)
+  {
+    if(g_str_has_suffix(groups[i], "#positions"))
+      continue;
+
+    gchar* path      = g_strescape(groups[i], NULL);
+    gchar* positions = g_strdup_printf("%s#positions", groups[i]);
+
+    if(g_key_file_has_key(data, groups[i], bm_reserved_names[BM_PAGE_ENTRY], NULL))
+      g_string_append_printf(records, "P\t%s\t%d\t%d\t%d\n", path,
+          g_key_file_get_integer(data, groups[i], bm_reserved_names[BM_PAGE_ENTRY], NULL),
+          g_key_file_get_integer(data, groups[i], bm_reserved_names[BM_PAGE_OFFSET], NULL),
+          g_key_file_get_integer(data, groups[i], bm_reserved_names[BM_PAGE_SCALE], NULL));
+
+    gchar** keys = g_key_file_get_keys(data, groups[i], NULL, NULL);
+    int j;
+    for(j = 0; keys && keys[j]; j++)
+    {
+      if(is_reserved_bm_name(keys[j]))
+        continue;
+
+      gsize length   = 0;
+      gint* location = g_key_file_get_integer_list(data, positions, keys[j], &length, NULL);
+      gchar* name    = g_strescape(keys[j], NULL);
+
+      g_string_append_printf(records, "B\t%s\t%s\t%d\t%d\t%d\t%d\n", path, name,
+          g_key_file_get_integer(data, groups[i], keys[j], NULL),
+          (location && length == 3) ? location[0] : 0,
+          (location && length == 3) ? location[1] : 0,
+          (location && length == 3) ? location[2] : 0);
+
+      g_free(name);
+      g_free(location);
+    }
+
+    g_strfreev(keys);
+    g_free(positions);
+    g_free(path);
+  }
+
+  g_file_set_contents(Zathura.Bookmarks.file, records->str, records->len, NULL);
+
+  g_strfreev(groups);
+  g_string_free(records, TRUE);
+  g_key_file_free(data);
+}
+
+void
+apply_bookmark_record(gchar* line)
+{
+  gchar** fields = g_strsplit(line, "\t", -1);
+  int number_of_fields = g_strv_length(fields);
+
+  if(number_of_fields < 3)
+  {
+    g_strfreev(fields);
+    return;
+  }
+
+  gchar* path = g_strcompress(fields[1]);
+  BookmarkRecord* record = g_hash_table_lookup(Zathura.Bookmarks.documents, path);
+  if(!record)
+  {
+    record = malloc(sizeof(BookmarkRecord));
+    if(!record)
+      out_of_memory();
+
+    record->has_position = FALSE;
+    record->page         = 0;
+    record->offset       = 0;
+    record->scale        = 0;
+    record->position.x   = 0;
+    record->position.y   = 0;
+    record->bookmarks    = NULL;
+    g_hash_table_insert(Zathura.Bookmarks.documents, g_strdup(path), record);
+  }
+
+  /* position: P path page offset scale [x y] */
+  if(!strcmp(fields[0], "P") && (number_of_fields == 5 || number_of_fields == 7))
+  {
+    record->has_position = TRUE;
+    record->page         = atoi(fields[2]);
+    record->offset       = atoi(fields[3]);
+    record->scale        = atoi(fields[4]);
+    record->position.x   = (number_of_fields == 7) ? atoi(fields[5]) : 0;
+    record->position.y   = (number_of_fields == 7) ? atoi(fields[6]) : 0;
+  }
+  /* bookmark: B path name page scale x y, delete: D path name */
+  else if(!strcmp(fields[0], "B") || !strcmp(fields[0], "D"))
+  {
+    gchar* name = g_strcompress(fields[2]);
+
+    GList* list;
+    for(list = record->bookmarks; list; list = g_list_next(list))
+    {
+      Bookmark* bookmark = (Bookmark*) list->data;
+      if(!strcmp(bookmark->id, name))
+      {
+        g_free(bookmark->id);
+        free(bookmark);
+        record->bookmarks = g_list_delete_link(record->bookmarks, list);
+        break;
+      }
+    }
+
+    if(!strcmp(fields[0], "B") && number_of_fields == 7)
+    {
+      Bookmark* bookmark = malloc(sizeof(Bookmark));
+      if(!bookmark)
+        out_of_memory();
+
+      bookmark->id         = g_strdup(name);
+      bookmark->page       = atoi(fields[3]);
+      bookmark->scale      = atoi(fields[4]);
+      bookmark->position.x = atoi(fields[5]);
+      bookmark->position.y = atoi(fields[6]);
+      record->bookmarks    = g_list_append(record->bookmarks, bookmark);
+    }
+
+    g_free(name);
+  }
+
+  g_free(path);
+  g_strfreev(fields);
+}
+
+void
+store_bookmark_record(gchar* record, const gchar* key)
+{
+  LOCK(bookmarks_lock);
+
+  gchar* line = g_strndup(record, strlen(record) - 1);
+  apply_bookmark_record(line);
+  g_free(line);
+
+  /* a queued record with the same key is replaced */
+  GList* link = key ? g_hash_table_lookup(Zathura.Bookmarks.queued_positions, key) : NULL;
+  if(link)
+  {
+    g_free(link->data);
+    link->data = record;
+  }
+  else
+  {
+    g_queue_push_tail(Zathura.Bookmarks.queue, record);
+    if(key)
+      g_hash_table_insert(Zathura.Bookmarks.queued_positions, g_strdup(key), Zathura.Bookmarks.queue->tail);
+    g_cond_signal(Zathura.Bookmarks.cond);
+  }
+
+  g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+}
+
+void
+store_position(void)
+{
+  if(!Zathura.PDF.document || (!save_position && !save_zoom_level))
+    return;
+
+  LOCK(bookmarks_lock);
+  BookmarkRecord* record = g_hash_table_lookup(Zathura.Bookmarks.documents, Zathura.PDF.file);
+  PagePosition position  = { 0, 0 };
+
+  int page   = save_position   ? Zathura.PDF.page_number : (record ? record->page   : 0);
+  int offset = save_position   ? Zathura.PDF.page_offset : (record ? record->offset : 0);
+  int scale  = save_zoom_level ? Zathura.PDF.scale       : (record ? record->scale  : 0);
+  g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+  if(save_position)
+    save_page_position(&position, 0);
+
+  gchar* path   = g_strescape(Zathura.PDF.file, NULL);
+  gchar* record_line = g_strdup_printf("P\t%s\t%d\t%d\t%d\t%d\t%d\n", path, page, offset, scale,
+      (int) position.x, (int) position.y);
+  g_free(path);
+
+  /* nothing changed since the last time */
+  if(Zathura.Bookmarks.last_position && !strcmp(Zathura.Bookmarks.last_position, record_line))
+  {
+    g_free(record_line);
+    return;
+  }
+
+  g_free(Zathura.Bookmarks.last_position);
+  Zathura.Bookmarks.last_position = g_strdup(record_line);
+  store_bookmark_record(record_line, Zathura.PDF.file);
+}
+
+void
+compact_bookmarks_file(void)
+{
+  int number_of_records = 0;
+
+  LOCK(bookmarks_lock);
+  if(Zathura.Bookmarks.snapshot)
+  {
+    g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+    return;
+  }
+
+  /* only rewrite the file if most of its records are obsolete */
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init(&iter, Zathura.Bookmarks.documents);
+  while(g_hash_table_iter_next(&iter, &key, &value))
+    number_of_records += 1 + g_list_length(((BookmarkRecord*) value)->bookmarks);
+
+  if(Zathura.Bookmarks.records < 2 * number_of_records + 1024)
+  {
+    g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+    return;
+  }
+
+  /* the writer replaces the file with a snapshot of the index */
+  GString* snapshot = g_string_new("");
+
+  g_hash_table_iter_init(&iter, Zathura.Bookmarks.documents);
+  while(g_hash_table_iter_next(&iter, &key, &value))
   {
-    bm = Zathura.Bookmarks.bookmarks[i];
+    BookmarkRecord* record = (BookmarkRecord*) value;
+    gchar* path = g_strescape((gchar*) key, NULL);
+
+    if(record->has_position)
+      g_string_append_printf(snapshot, "P\t%s\t%d\t%d\t%d\t%d\t%d\n", path, record->page,
+          record->offset, record->scale, (int) record->position.x, (int) record->position.y);
+
+    GList* list;
+    for(list = record->bookmarks; list; list = g_list_next(list))
+    {
+      Bookmark* bookmark = (Bookmark*) list->data;
+      gchar* name = g_strescape(bookmark->id, NULL);
+      g_string_append_printf(snapshot, "B\t%s\t%s\t%d\t%d\t%d\t%d\n", path, name, bookmark->page,
+          bookmark->scale, (int) bookmark->position.x, (int) bookmark->position.y);
+      g_free(name);
+    }
+
+    g_free(path);
+  }
 
-    g_key_file_set_integer(Zathura.Bookmarks.data, master_section,
-                           bm.id, bm.page);
+  /* the snapshot contains the records of the file up to here */
+  Zathura.Bookmarks.records         = number_of_records;
+  Zathura.Bookmarks.snapshot        = g_string_free(snapshot, FALSE);
+  Zathura.Bookmarks.snapshot_inode  = Zathura.Bookmarks.inode;
+  Zathura.Bookmarks.snapshot_offset = Zathura.Bookmarks.offset;
+  g_cond_signal(Zathura.Bookmarks.cond);
+  g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+}
+
+void
+load_bookmarks(const char* file)
+{
+  free_bookmarks();
 
-    location[0] = bm.scale;
-    location[1] = bm.position.x;
-    location[2] = bm.position.y;
-    g_key_file_set_integer_list(Zathura.Bookmarks.data, positions_section,
-                                bm.id, location, location_length);
+  LOCK(bookmarks_lock);
+  BookmarkRecord* record = g_hash_table_lookup(Zathura.Bookmarks.documents, file);
+  if(!record)
+  {
+    g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+    return;
   }
 
-  g_free(positions_section);
-  g_free(master_section);
-  free(location);
+  GList* list;
+  for(list = record->bookmarks; list; list = g_list_next(list))
+  {
+    Bookmark* bookmark = (Bookmark*) list->data;
+    int next = Zathura.Bookmarks.number_of_bookmarks;
+
+    Zathura.Bookmarks.bookmarks = realloc(Zathura.Bookmarks.bookmarks,
+        (next + 1) * sizeof(Bookmark));
+    if(!Zathura.Bookmarks.bookmarks)
+      out_of_memory();
+
+    Zathura.Bookmarks.bookmarks[next]    = *bookmark;
+    Zathura.Bookmarks.bookmarks[next].id = g_strdup(bookmark->id);
+    if(bookmark->scale <= 0)
+      Zathura.Bookmarks.bookmarks[next].scale = Zathura.PDF.scale;
 
-  /* convert file and save it */
-  gchar* bookmarks = g_key_file_to_data(Zathura.Bookmarks.data, NULL, NULL);
-  g_file_set_contents(Zathura.Bookmarks.file, bookmarks, -1, NULL);
-  g_free(bookmarks);
+    Zathura.Bookmarks.number_of_bookmarks++;
+  }
+  g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
 }
 
 void
@@ -1682,6 +3080,23 @@ free_bookmarks(void)
   Zathura.Bookmarks.number_of_bookmarks = 0;
 }
 
+void
+free_bookmark_record(gpointer data)
+{
+  BookmarkRecord* record = (BookmarkRecord*) data;
+
+  GList* list;
+  for(list = record->bookmarks; list; list = g_list_next(list))
+  {
+    Bookmark* bookmark = (Bookmark*) list->data;
+    g_free(bookmark->id);
+    free(bookmark);
+  }
+
+  g_list_free(record->bookmarks);
+  free(record);
+}
+
 void
 read_configuration_file(const char* rcfile)
 {
@@ -1742,18 +3157,23 @@ void
 recalc_rectangle(int page_id, PopplerRectangle* rectangle)
 {
   double page_width, page_height;
-  double x1 = rectangle->x1;
-  double x2 = rectangle->x2;
-  double y1 = rectangle->y1;
-  double y2 = rectangle->y2;
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+  LOCK(pdflib_lock);
   poppler_page_get_size(Zathura.PDF.pages[page_id]->page, &page_width, &page_height);
   g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
-  double scale = ((double) Zathura.PDF.scale / 100.0);
+  transform_rectangle(rectangle, page_width, page_height,
+      ((double) Zathura.PDF.scale / 100.0), Zathura.PDF.rotate);
+}
 
-  int rotate = Zathura.PDF.rotate;
+void
+transform_rectangle(PopplerRectangle* rectangle, double page_width, double page_height,
+    double scale, int rotate)
+{
+  double x1 = rectangle->x1;
+  double x2 = rectangle->x2;
+  double y1 = rectangle->y1;
+  double y2 = rectangle->y2;
 
   switch(rotate)
   {
@@ -1783,125 +3203,416 @@ recalc_rectangle(int page_id, PopplerRectangle* rectangle)
   }
 }
 
-GtkEventBox*
-create_completion_row(GtkBox* results, char* command, char* description, gboolean group)
+void
+get_page_size(int page_id, double* width, double* height)
 {
-  GtkBox      *col = GTK_BOX(gtk_hbox_new(FALSE, 0));
-  GtkEventBox *row = GTK_EVENT_BOX(gtk_event_box_new());
-
-  GtkLabel *show_command     = GTK_LABEL(gtk_label_new(NULL));
-  GtkLabel *show_description = GTK_LABEL(gtk_label_new(NULL));
+  Page* page = Zathura.PDF.pages[page_id];
 
-  gtk_misc_set_alignment(GTK_MISC(show_command),     0.0, 0.0);
-  gtk_misc_set_alignment(GTK_MISC(show_description), 0.0, 0.0);
-
-  if(group)
+  /* the size of a page does not change, so it is only asked for once */
+  if(page->width <= 0 || page->height <= 0)
   {
-    gtk_misc_set_padding(GTK_MISC(show_command),     2.0, 4.0);
-    gtk_misc_set_padding(GTK_MISC(show_description), 2.0, 4.0);
-  }
-  else
-  {
-    gtk_misc_set_padding(GTK_MISC(show_command),     1.0, 1.0);
-    gtk_misc_set_padding(GTK_MISC(show_description), 1.0, 1.0);
+    LOCK(pdflib_lock);
+    poppler_page_get_size(page->page, &(page->width), &(page->height));
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
   }
 
-  gtk_label_set_use_markup(show_command,     TRUE);
-  gtk_label_set_use_markup(show_description, TRUE);
+  *width  = page->width;
+  *height = page->height;
+}
 
-  gchar* c = g_markup_printf_escaped(FORMAT_COMMAND,     command ? command : "");
-  gchar* d = g_markup_printf_escaped(FORMAT_DESCRIPTION, description ? description : "");
-  gtk_label_set_markup(show_command,     c);
-  gtk_label_set_markup(show_description, d);
-  g_free(c);
-  g_free(d);
+PageLinks*
+get_page_links(int page_id)
+{
+  Page* page = Zathura.PDF.pages[page_id];
+  PageLinks* links = page->links;
 
-  if(group)
-  {
-    gtk_widget_modify_fg(GTK_WIDGET(show_command),     GTK_STATE_NORMAL, &(Zathura.Style.completion_g_fg));
-    gtk_widget_modify_fg(GTK_WIDGET(show_description), GTK_STATE_NORMAL, &(Zathura.Style.completion_g_fg));
-    gtk_widget_modify_bg(GTK_WIDGET(row),              GTK_STATE_NORMAL, &(Zathura.Style.completion_g_bg));
-  }
-  else
+  /* read the links of the page once */
+  if(!links)
   {
-    gtk_widget_modify_fg(GTK_WIDGET(show_command),     GTK_STATE_NORMAL, &(Zathura.Style.completion_fg));
-    gtk_widget_modify_fg(GTK_WIDGET(show_description), GTK_STATE_NORMAL, &(Zathura.Style.completion_fg));
-    gtk_widget_modify_bg(GTK_WIDGET(row),              GTK_STATE_NORMAL, &(Zathura.Style.completion_bg));
-  }
-
-  gtk_widget_modify_font(GTK_WIDGET(show_command),     Zathura.Style.font);
-  gtk_widget_modify_font(GTK_WIDGET(show_description), Zathura.Style.font);
+    links = malloc(sizeof(PageLinks));
+    if(!links)
+      out_of_memory();
 
-  gtk_box_pack_start(GTK_BOX(col), GTK_WIDGET(show_command),     TRUE,  TRUE,  2);
-  gtk_box_pack_start(GTK_BOX(col), GTK_WIDGET(show_description), FALSE, FALSE, 2);
+    LOCK(pdflib_lock);
+    links->mapping = poppler_page_get_link_mapping(page->page);
+    poppler_page_get_size(page->page, &(links->page_width), &(links->page_height));
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
-  gtk_container_add(GTK_CONTAINER(row), GTK_WIDGET(col));
+    /* only URI and internal links, in the order of the follow hints */
+    links->links           = malloc(sizeof(Link) * (g_list_length(links->mapping) + 1));
+    links->number_of_links = 0;
+    links->cells           = NULL;
+    links->scale           = -1;
+    links->rotate          = -1;
+    if(!links->links)
+      out_of_memory();
 
-  gtk_box_pack_start(results, GTK_WIDGET(row), FALSE, FALSE, 0);
+    GList* list;
+    for(list = g_list_last(links->mapping); list; list = g_list_previous(list))
+    {
+      PopplerLinkMapping* link_mapping = (PopplerLinkMapping*) list->data;
+      PopplerAction*      action       = link_mapping->action;
 
-  return row;
-}
+      if(action->type == POPPLER_ACTION_URI || action->type == POPPLER_ACTION_GOTO_DEST)
+      {
+        links->links[links->number_of_links].area   = link_mapping->area;
+        links->links[links->number_of_links].action = action;
+        links->number_of_links++;
+      }
+    }
 
-void
-set_completion_row_color(GtkBox* results, int mode, int id)
-{
-  GtkEventBox *row   = (GtkEventBox*) g_list_nth_data(gtk_container_get_children(GTK_CONTAINER(results)), id);
+    page->links = links;
+  }
 
-  if(row)
+  /* convert to device coordinates if the scale or rotation changed */
+  if(links->scale != Zathura.PDF.scale || links->rotate != Zathura.PDF.rotate)
   {
-    GtkBox      *col   = (GtkBox*)      g_list_nth_data(gtk_container_get_children(GTK_CONTAINER(row)), 0);
-    GtkLabel    *cmd   = (GtkLabel*)    g_list_nth_data(gtk_container_get_children(GTK_CONTAINER(col)), 0);
-    GtkLabel    *cdesc = (GtkLabel*)    g_list_nth_data(gtk_container_get_children(GTK_CONTAINER(col)), 1);
+    double scale = ((double) Zathura.PDF.scale / 100.0);
+    double width = ((Zathura.PDF.rotate == 0 || Zathura.PDF.rotate == 180) ?
+        links->page_width : links->page_height) * scale;
+    double height = ((Zathura.PDF.rotate == 0 || Zathura.PDF.rotate == 180) ?
+        links->page_height : links->page_width) * scale;
 
-    if(mode == NORMAL)
+    int i;
+    if(links->cells)
     {
-      gtk_widget_modify_fg(GTK_WIDGET(cmd),   GTK_STATE_NORMAL, &(Zathura.Style.completion_fg));
-      gtk_widget_modify_fg(GTK_WIDGET(cdesc), GTK_STATE_NORMAL, &(Zathura.Style.completion_fg));
-      gtk_widget_modify_bg(GTK_WIDGET(row),   GTK_STATE_NORMAL, &(Zathura.Style.completion_bg));
+      for(i = 0; i < links->columns * links->rows; i++)
+        g_slist_free(links->cells[i]);
+      free(links->cells);
     }
-    else
+
+    links->scale   = Zathura.PDF.scale;
+    links->rotate  = Zathura.PDF.rotate;
+    links->columns = width  / LINK_GRID_SIZE + 1;
+    links->rows    = height / LINK_GRID_SIZE + 1;
+    links->cells   = calloc(links->columns * links->rows, sizeof(GSList*));
+    if(!links->cells)
+      out_of_memory();
+
+    for(i = 0; i < links->number_of_links; i++)
     {
-      gtk_widget_modify_fg(GTK_WIDGET(cmd),   GTK_STATE_NORMAL, &(Zathura.Style.completion_hl_fg));
-      gtk_widget_modify_fg(GTK_WIDGET(cdesc), GTK_STATE_NORMAL, &(Zathura.Style.completion_hl_fg));
-      gtk_widget_modify_bg(GTK_WIDGET(row),   GTK_STATE_NORMAL, &(Zathura.Style.completion_hl_bg));
+      PopplerRectangle* device = &(links->links[i].device);
+      *device = links->links[i].area;
+      transform_rectangle(device, links->page_width, links->page_height, scale, Zathura.PDF.rotate);
+
+      /* normalize so that p1 is the top-left corner */
+      double d;
+      if(device->x1 > device->x2)
+      {
+        d = device->x1; device->x1 = device->x2; device->x2 = d;
+      }
+      if(device->y1 > device->y2)
+      {
+        d = device->y1; device->y1 = device->y2; device->y2 = d;
+      }
+
+      /* register the link in every cell it overlaps */
+      int column_start = CLAMP(device->x1 / LINK_GRID_SIZE, 0, links->columns - 1);
+      int column_end   = CLAMP(device->x2 / LINK_GRID_SIZE, 0, links->columns - 1);
+      int row_start    = CLAMP(device->y1 / LINK_GRID_SIZE, 0, links->rows - 1);
+      int row_end      = CLAMP(device->y2 / LINK_GRID_SIZE, 0, links->rows - 1);
+
+      int row, column;
+      for(row = row_start; row <= row_end; row++)
+        for(column = column_start; column <= column_end; column++)
+          links->cells[row * links->columns + column] =
+            g_slist_prepend(links->cells[row * links->columns + column], GINT_TO_POINTER(i));
     }
   }
+
+  return links;
 }
 
 void
-set_page(int page)
+free_page_links(PageLinks* links)
 {
-  if(page >= Zathura.PDF.number_of_pages || page < 0)
-  {
-    notify(WARNING, "Could not open page");
+  if(!links)
     return;
+
+  if(links->cells)
+  {
+    int i;
+    for(i = 0; i < links->columns * links->rows; i++)
+      g_slist_free(links->cells[i]);
+    free(links->cells);
   }
 
-  Zathura.PDF.page_number = page;
-  Zathura.Search.draw     = FALSE;
+  poppler_page_free_link_mapping(links->mapping);
+  free(links->links);
+  free(links);
+}
 
-  PagePosition point = { 0, 0 };
-  if(Zathura.Global.mode == FULLSCREEN)
-    save_page_position(&point, 0);
+Link*
+find_link(int page_id, double x, double y)
+{
+  PageLinks* links = get_page_links(page_id);
+  if(links->number_of_links == 0 || x < 0 || y < 0)
+    return NULL;
 
-  switch_view(Zathura.UI.document);
-  draw(page);
+  int column = x / LINK_GRID_SIZE;
+  int row    = y / LINK_GRID_SIZE;
+  if(column >= links->columns || row >= links->rows)
+    return NULL;
 
-  restore_page_position(&point);
+  GSList* list;
+  for(list = links->cells[row * links->columns + column]; list; list = g_slist_next(list))
+  {
+    Link* link = &(links->links[GPOINTER_TO_INT(list->data)]);
+    if(x >= link->device.x1 && x <= link->device.x2 && y >= link->device.y1 && y <= link->device.y2)
+      return link;
+  }
+
+  return NULL;
 }
 
-void
-save_page_position(PagePosition* position, int flip)
+gboolean
+follow_link(PopplerAction* action)
 {
-  GtkAdjustment* adjustment;
-  adjustment  = gtk_scrolled_window_get_hadjustment(Zathura.UI.view);
-  position->x = gtk_adjustment_get_value(adjustment);
-  if(flip) {
-    gdouble page  = gtk_adjustment_get_page_size(adjustment);
-    gdouble max = gtk_adjustment_get_upper(adjustment) - page;
-    position->x = max - position->x;
-  }
-  adjustment  = gtk_scrolled_window_get_vadjustment(Zathura.UI.view);
+  if(action->type == POPPLER_ACTION_URI)
+    open_uri(action->uri.uri);
+  else if(action->type == POPPLER_ACTION_GOTO_DEST)
+  {
+    int page_number = find_dest_page(action->goto_dest.dest);
+    if(page_number > 0)
+    {
+      add_jump();
+      set_page(page_number - 1);
+      update_status();
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+PageText*
+get_page_text_layout(int page_id)
+{
+  Page* page = Zathura.PDF.pages[page_id];
+  PageText* text = page->text;
+
+#if POPPLER_CHECK_VERSION(0,16,0)
+  /* read the text and the glyph boxes of the page once */
+  if(!text)
+  {
+    text = malloc(sizeof(PageText));
+    if(!text)
+      out_of_memory();
+
+    text->rectangles = NULL;
+    text->length     = 0;
+
+    LOCK(pdflib_lock);
+    text->text = get_page_text(page->page);
+    poppler_page_get_size(page->page, &(text->page_width), &(text->page_height));
+    if(!poppler_page_get_text_layout(page->page, &(text->rectangles), &(text->length)))
+      text->length = 0;
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+    /* there is one box per character */
+    glong characters = text->text ? g_utf8_strlen(text->text, -1) : 0;
+    if(text->length > characters)
+      text->length = characters;
+
+    text->device = malloc(sizeof(PopplerRectangle) * (text->length + 1));
+    text->scale  = -1;
+    text->rotate = -1;
+    if(!text->device)
+      out_of_memory();
+
+    page->text = text;
+  }
+#else
+  return NULL;
+#endif
+
+  /* convert to device coordinates if the scale or rotation changed */
+  if(text->scale != Zathura.PDF.scale || text->rotate != Zathura.PDF.rotate)
+  {
+    double scale = ((double) Zathura.PDF.scale / 100.0);
+
+    guint i;
+    for(i = 0; i < text->length; i++)
+    {
+      PopplerRectangle* device = &(text->device[i]);
+      *device = text->rectangles[i];
+
+      /* the layout uses a top-left origin */
+      device->y1 = text->page_height - text->rectangles[i].y1;
+      device->y2 = text->page_height - text->rectangles[i].y2;
+      transform_rectangle(device, text->page_width, text->page_height, scale, Zathura.PDF.rotate);
+
+      double d;
+      if(device->x1 > device->x2)
+      {
+        d = device->x1; device->x1 = device->x2; device->x2 = d;
+      }
+      if(device->y1 > device->y2)
+      {
+        d = device->y1; device->y1 = device->y2; device->y2 = d;
+      }
+    }
+
+    text->scale  = Zathura.PDF.scale;
+    text->rotate = Zathura.PDF.rotate;
+  }
+
+  return text;
+}
+
+void
+free_page_text_layout(PageText* text)
+{
+  if(!text)
+    return;
+
+  g_free(text->text);
+  g_free(text->rectangles);
+  free(text->device);
+  free(text);
+}
+
+int
+find_glyph(PageText* text, double x, double y)
+{
+  int    glyph    = -1;
+  double distance = G_MAXDOUBLE;
+
+  /* the glyph closest to the point */
+  guint i;
+  for(i = 0; i < text->length; i++)
+  {
+    PopplerRectangle* device = &(text->device[i]);
+    double dx = (x < device->x1) ? device->x1 - x : (x > device->x2) ? x - device->x2 : 0;
+    double dy = (y < device->y1) ? device->y1 - y : (y > device->y2) ? y - device->y2 : 0;
+    double d  = dx * dx + dy * dy;
+
+    if(d < distance)
+    {
+      distance = d;
+      glyph    = i;
+      if(d == 0)
+        break;
+    }
+  }
+
+  return glyph;
+}
+
+GtkEventBox*
+create_completion_row(GtkBox* results, char* command, char* description, gboolean group)
+{
+  GtkBox      *col = GTK_BOX(gtk_hbox_new(FALSE, 0));
+  GtkEventBox *row = GTK_EVENT_BOX(gtk_event_box_new());
+
+  GtkLabel *show_command     = GTK_LABEL(gtk_label_new(NULL));
+  GtkLabel *show_description = GTK_LABEL(gtk_label_new(NULL));
+
+  gtk_misc_set_alignment(GTK_MISC(show_command),     0.0, 0.0);
+  gtk_misc_set_alignment(GTK_MISC(show_description), 0.0, 0.0);
+
+  gtk_label_set_use_markup(show_command,     TRUE);
+  gtk_label_set_use_markup(show_description, TRUE);
+
+  gtk_widget_modify_font(GTK_WIDGET(show_command),     Zathura.Style.font);
+  gtk_widget_modify_font(GTK_WIDGET(show_description), Zathura.Style.font);
+
+  gtk_box_pack_start(GTK_BOX(col), GTK_WIDGET(show_command),     TRUE,  TRUE,  2);
+  gtk_box_pack_start(GTK_BOX(col), GTK_WIDGET(show_description), FALSE, FALSE, 2);
+
+  gtk_container_add(GTK_CONTAINER(row), GTK_WIDGET(col));
+
+  gtk_box_pack_start(results, GTK_WIDGET(row), FALSE, FALSE, 0);
+
+  g_object_set_data(G_OBJECT(row), "command",     show_command);
+  g_object_set_data(G_OBJECT(row), "description", show_description);
+
+  update_completion_row(row, command, description, group, NORMAL);
+
+  return row;
+}
+
+void
+update_completion_row(GtkEventBox* row, char* command, char* description, gboolean group, int mode)
+{
+  GtkLabel *cmd   = (GtkLabel*) g_object_get_data(G_OBJECT(row), "command");
+  GtkLabel *cdesc = (GtkLabel*) g_object_get_data(G_OBJECT(row), "description");
+
+  if(!cmd || !cdesc)
+    return;
+
+  if(group)
+  {
+    gtk_misc_set_padding(GTK_MISC(cmd),   2.0, 4.0);
+    gtk_misc_set_padding(GTK_MISC(cdesc), 2.0, 4.0);
+  }
+  else
+  {
+    gtk_misc_set_padding(GTK_MISC(cmd),   1.0, 1.0);
+    gtk_misc_set_padding(GTK_MISC(cdesc), 1.0, 1.0);
+  }
+
+  gchar* c = g_markup_printf_escaped(FORMAT_COMMAND,     command ? command : "");
+  gchar* d = g_markup_printf_escaped(FORMAT_DESCRIPTION, description ? description : "");
+  gtk_label_set_markup(cmd,   c);
+  gtk_label_set_markup(cdesc, d);
+  g_free(c);
+  g_free(d);
+
+  if(group)
+  {
+    gtk_widget_modify_fg(GTK_WIDGET(cmd),   GTK_STATE_NORMAL, &(Zathura.Style.completion_g_fg));
+    gtk_widget_modify_fg(GTK_WIDGET(cdesc), GTK_STATE_NORMAL, &(Zathura.Style.completion_g_fg));
+    gtk_widget_modify_bg(GTK_WIDGET(row),   GTK_STATE_NORMAL, &(Zathura.Style.completion_g_bg));
+  }
+  else if(mode == NORMAL)
+  {
+    gtk_widget_modify_fg(GTK_WIDGET(cmd),   GTK_STATE_NORMAL, &(Zathura.Style.completion_fg));
+    gtk_widget_modify_fg(GTK_WIDGET(cdesc), GTK_STATE_NORMAL, &(Zathura.Style.completion_fg));
+    gtk_widget_modify_bg(GTK_WIDGET(row),   GTK_STATE_NORMAL, &(Zathura.Style.completion_bg));
+  }
+  else
+  {
+    gtk_widget_modify_fg(GTK_WIDGET(cmd),   GTK_STATE_NORMAL, &(Zathura.Style.completion_hl_fg));
+    gtk_widget_modify_fg(GTK_WIDGET(cdesc), GTK_STATE_NORMAL, &(Zathura.Style.completion_hl_fg));
+    gtk_widget_modify_bg(GTK_WIDGET(row),   GTK_STATE_NORMAL, &(Zathura.Style.completion_hl_bg));
+  }
+}
+
+void
+set_page(int page)
+{
+  if(page >= Zathura.PDF.number_of_pages || page < 0)
+  {
+    notify(WARNING, "Could not open page");
+    return;
+  }
+
+  Zathura.PDF.page_number = page;
+  Zathura.Search.draw     = FALSE;
+
+  PagePosition point = { 0, 0 };
+  if(Zathura.Global.mode == FULLSCREEN)
+    save_page_position(&point, 0);
+
+  switch_view(Zathura.UI.document);
+  draw(page);
+
+  restore_page_position(&point);
+}
+
+void
+save_page_position(PagePosition* position, int flip)
+{
+  GtkAdjustment* adjustment;
+  adjustment  = gtk_scrolled_window_get_hadjustment(Zathura.UI.view);
+  position->x = gtk_adjustment_get_value(adjustment);
+  if(flip) {
+    gdouble page  = gtk_adjustment_get_page_size(adjustment);
+    gdouble max = gtk_adjustment_get_upper(adjustment) - page;
+    position->x = max - position->x;
+  }
+  adjustment  = gtk_scrolled_window_get_vadjustment(Zathura.UI.view);
   position->y = gtk_adjustment_get_value(adjustment);
   if(flip) {
     gdouble page  = gtk_adjustment_get_page_size(adjustment);
@@ -2010,147 +3721,1704 @@ void completion_free(Completion* completion)
   free(completion);
 }
 
-void completion_group_add_element(CompletionGroup* group, char* name, char* description)
-{
-  CompletionElement* el = group->elements;
+void completion_group_add_element(CompletionGroup* group, char* name, char* description)
+{
+  CompletionElement* el = group->elements;
+
+  while(el && el->next)
+    el = el->next;
+
+  CompletionElement* new_element = malloc(sizeof(CompletionElement));
+  if(!new_element)
+    out_of_memory();
+
+  new_element->value       = name ? g_strdup(name) : NULL;
+  new_element->description = description ?  g_strdup(description) : NULL;
+  new_element->next        = NULL;
+
+  if(el)
+    el->next = new_element;
+  else
+    group->elements = new_element;
+}
+
+int
+get_number_of_workers(void)
+{
+  long number_of_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return (number_of_cpus > 0) ? number_of_cpus : 1;
+}
+
+gchar*
+get_page_text(PopplerPage* page)
+{
+#if POPPLER_CHECK_VERSION(0,16,0)
+  return poppler_page_get_text(page);
+#else
+  PopplerRectangle rectangle = { 0, 0, 0, 0 };
+  poppler_page_get_size(page, &rectangle.x2, &rectangle.y2);
+  return poppler_page_get_text(page, POPPLER_SELECTION_GLYPH, &rectangle);
+#endif
+}
+
+gchar**
+get_document_text(const gchar* file)
+{
+  struct stat info;
+  if(g_stat(file, &info) != 0)
+    return NULL;
+
+  /* the text of every document is cached in the data directory and is
+   * only extracted again if the document changes */
+  gchar* checksum  = g_compute_checksum_for_string(G_CHECKSUM_SHA1, file, -1);
+  gchar* directory = g_build_filename(Zathura.Config.data_dir, TEXT_CACHE_DIR, NULL);
+  gchar* cache     = g_build_filename(directory, checksum, NULL);
+  gchar* header    = g_strdup_printf("%ld %ld\n", (long) info.st_mtime, (long) info.st_size);
+  g_free(checksum);
+
+  gchar** pages   = NULL;
+  gchar*  content = NULL;
+
+  if(g_file_get_contents(cache, &content, NULL, NULL) && g_str_has_prefix(content, header))
+    pages = g_strsplit(content + strlen(header), "\f", -1);
+  else
+  {
+    /* every worker uses its own document, so there is no need to hold the
+     * pdflib lock */
+    gchar* uri = g_filename_to_uri(file, NULL, NULL);
+    PopplerDocument* document = uri ? poppler_document_new_from_file(uri, NULL, NULL) : NULL;
+    g_free(uri);
+
+    if(document)
+    {
+      int number_of_pages = poppler_document_get_n_pages(document);
+      pages = g_malloc0((number_of_pages + 1) * sizeof(gchar*));
+
+      int i;
+      for(i = 0; i < number_of_pages; i++)
+      {
+        PopplerPage* page = poppler_document_get_page(document, i);
+        if(page)
+        {
+          pages[i] = get_page_text(page);
+          g_object_unref(page);
+        }
+
+        /* form feeds separate the pages in the cache */
+        if(!pages[i])
+          pages[i] = g_strdup("");
+        g_strdelimit(pages[i], "\f", ' ');
+      }
+
+      g_object_unref(document);
+
+      gchar* text = g_strjoinv("\f", pages);
+      gchar* data = g_strconcat(header, text, NULL);
+      g_mkdir_with_parents(directory, 0771);
+      g_file_set_contents(cache, data, -1, NULL);
+      g_free(data);
+      g_free(text);
+    }
+  }
+
+  g_free(content);
+  g_free(header);
+  g_free(cache);
+  g_free(directory);
+
+  return pages;
+}
+
+void
+free_grep_hits(GList* hits)
+{
+  GList* list;
+  for(list = hits; list; list = g_list_next(list))
+  {
+    GrepHit* hit = (GrepHit*) list->data;
+    g_free(hit->file);
+    g_free(hit->context);
+    free(hit);
+  }
+
+  g_list_free(hits);
+}
+
+gint
+compare_grep_hits(gconstpointer a, gconstpointer b)
+{
+  const GrepHit* hit_a = (const GrepHit*) a;
+  const GrepHit* hit_b = (const GrepHit*) b;
+
+  int result = strcmp(hit_a->file, hit_b->file);
+  return result ? result : (hit_a->page - hit_b->page);
+}
+
+int
+find_dest_page(PopplerDest* dest)
+{
+  if(dest->type != POPPLER_DEST_NAMED)
+    return dest->page_num;
+
+  GHashTable* destinations = g_atomic_pointer_get(&Zathura.PDF.destinations);
+  if(destinations)
+    return GPOINTER_TO_INT(g_hash_table_lookup(destinations, dest->named_dest));
+
+  /* the document has not been scanned yet */
+  int page_number = 0;
+
+  LOCK(pdflib_lock);
+  PopplerDest* d = poppler_document_find_dest(Zathura.PDF.document, dest->named_dest);
+  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+  if(d)
+  {
+    page_number = d->page_num;
+    poppler_dest_free(d);
+  }
+
+  return page_number;
+}
+
+gint
+compare_sections(gconstpointer a, gconstpointer b)
+{
+  const Section* section_a = (const Section*) a;
+  const Section* section_b = (const Section*) b;
+
+  if(section_a->page != section_b->page)
+    return section_a->page - section_b->page;
+
+  return section_a->order - section_b->order;
+}
+
+void
+free_sections(SectionIndex* sections)
+{
+  if(!sections)
+    return;
+
+  int i;
+  for(i = 0; i < sections->number_of_sections; i++)
+    g_free(sections->sections[i].title);
+
+  free(sections->sections);
+  free(sections);
+}
+
+const char*
+get_section_title(int page)
+{
+  SectionIndex* sections = g_atomic_pointer_get(&Zathura.PDF.sections);
+  if(!sections || sections->number_of_sections == 0)
+    return NULL;
+
+  /* last section that starts on or before the page */
+  int low  = 0;
+  int high = sections->number_of_sections - 1;
+  int result = -1;
+
+  while(low <= high)
+  {
+    int middle = low + (high - low) / 2;
+    if(sections->sections[middle].page <= page)
+    {
+      result = middle;
+      low    = middle + 1;
+    }
+    else
+      high = middle - 1;
+  }
+
+  return (result >= 0) ? sections->sections[result].title : NULL;
+}
+
+DirectoryListing*
+get_directory_listing(const char* path)
+{
+  DirectoryListing* listing = g_hash_table_lookup(Zathura.Directories.listings, path);
+  if(listing)
+    return listing;
+
+  /* keep the number of watched directories bounded */
+  if(g_hash_table_size(Zathura.Directories.listings) >= DIRECTORY_CACHE_SIZE)
+    g_hash_table_remove_all(Zathura.Directories.listings);
+
+  listing = malloc(sizeof(DirectoryListing));
+  if(!listing)
+    out_of_memory();
+
+  listing->path       = g_strdup(path);
+  listing->entries    = NULL;
+  listing->monitor    = NULL;
+  listing->loading    = TRUE;
+  listing->generation = ++Zathura.Directories.generation;
+
+  /* drop the listing as soon as the directory changes */
+  GFile* file = g_file_new_for_path(path);
+  if(file)
+  {
+    listing->monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+    if(listing->monitor)
+      g_signal_connect(G_OBJECT(listing->monitor), "changed", G_CALLBACK(cb_directory_changed), listing);
+    g_object_unref(file);
+  }
+
+  g_hash_table_insert(Zathura.Directories.listings, listing->path, listing);
+
+  /* read it in the background, the result is only taken by the listing
+   * that started the thread */
+  DirectoryListing* result = malloc(sizeof(DirectoryListing));
+  if(!result)
+    out_of_memory();
+
+  result->path       = g_strdup(path);
+  result->entries    = NULL;
+  result->monitor    = NULL;
+  result->loading    = FALSE;
+  result->generation = listing->generation;
+
+  if(!g_thread_create(read_directory, result, FALSE, NULL))
+  {
+    free_directory_listing(result);
+    listing->loading = FALSE;
+  }
+
+  return listing;
+}
+
+void
+free_directory_listing(gpointer data)
+{
+  DirectoryListing* listing = (DirectoryListing*) data;
+
+  if(listing->monitor)
+  {
+    g_signal_handlers_disconnect_by_func(listing->monitor, cb_directory_changed, listing);
+    g_file_monitor_cancel(listing->monitor);
+    g_object_unref(listing->monitor);
+  }
+
+  if(listing->entries)
+    g_ptr_array_free(listing->entries, TRUE);
+
+  g_free(listing->path);
+  free(listing);
+}
+
+void
+update_printers(void)
+{
+  if(Zathura.Printers.loading)
+    return;
+
+  /* the cached list is used until it expires */
+  if(Zathura.Printers.list &&
+      g_get_monotonic_time() - Zathura.Printers.updated < (gint64) printer_list_ttl * G_USEC_PER_SEC)
+    return;
+
+  Zathura.Printers.loading = TRUE;
+  if(!g_thread_create(read_printers, g_strdup(list_printer_command), FALSE, NULL))
+    Zathura.Printers.loading = FALSE;
+}
+
+void
+wait_for_completion(void)
+{
+  g_free(Zathura.Global.pending_completion);
+  Zathura.Global.pending_completion = g_strdup(gtk_entry_get_text(Zathura.UI.inputbar));
+}
+
+void
+refresh_completion(void)
+{
+  if(!Zathura.Global.pending_completion)
+    return;
+
+  /* complete again if the user is still waiting for it */
+  gboolean waiting = gtk_widget_is_focus(GTK_WIDGET(Zathura.UI.inputbar)) &&
+    !strcmp(Zathura.Global.pending_completion, gtk_entry_get_text(Zathura.UI.inputbar));
+
+  g_free(Zathura.Global.pending_completion);
+  Zathura.Global.pending_completion = NULL;
+
+  if(waiting)
+  {
+    Argument argument;
+    argument.n = HIDE;
+    isc_completion(&argument);
+    argument.n = NEXT;
+    isc_completion(&argument);
+  }
+}
+
+int
+get_number_of_export_workers(void)
+{
+  return (export_threads > 0) ? export_threads : get_number_of_workers();
+}
+
+ExportJob*
+create_export_job(const char* path, int first_page, int last_page)
+{
+  ExportJob* job = malloc(sizeof(ExportJob));
+  if(!job)
+    out_of_memory();
+
+  memset(job, 0, sizeof(ExportJob));
+
+  /* every worker opens the document on its own */
+  job->uri        = g_filename_to_uri(Zathura.PDF.file, NULL, NULL);
+  job->password   = Zathura.PDF.password ? g_strdup(Zathura.PDF.password) : NULL;
+  job->first_page = first_page;
+  job->last_page  = last_page;
+  job->next_page  = first_page;
+  job->name       = g_path_get_basename(Zathura.PDF.file);
+
+  if(path[0] == '~')
+  {
+    gchar* home_path = get_home_dir();
+    job->path = g_strdup_printf("%s%s", home_path, path + 1);
+    g_free(home_path);
+  }
+  else
+    job->path = g_strdup(path);
+
+  return job;
+}
+
+gboolean
+parse_page_range(const char* range, int* first_page, int* last_page)
+{
+  /* 1-based "a-b", "a", "a-", "-b" or "all" */
+  int first = 1;
+  int last  = Zathura.PDF.number_of_pages;
+
+  if(strcmp(range, "all"))
+  {
+    char* end;
+    const char* separator = strchr(range, '-');
+
+    if(separator != range)
+    {
+      first = strtol(range, &end, 10);
+      if(end == range || (*end != '\0' && end != separator))
+        return FALSE;
+    }
+
+    if(!separator)
+      last = first;
+    else if(*(separator + 1) != '\0')
+    {
+      last = strtol(separator + 1, &end, 10);
+      if(*end != '\0')
+        return FALSE;
+    }
+  }
+
+  if(first < 1 || last > Zathura.PDF.number_of_pages || first > last)
+    return FALSE;
+
+  *first_page = first - 1;
+  *last_page  = last - 1;
+
+  return TRUE;
+}
+
+gboolean
+write_ppm(cairo_surface_t* surface, const char* file)
+{
+  FILE* fp = fopen(file, "wb");
+  if(!fp)
+    return FALSE;
+
+  unsigned char* image = cairo_image_surface_get_data(surface);
+  int width     = cairo_image_surface_get_width(surface);
+  int height    = cairo_image_surface_get_height(surface);
+  int rowstride = cairo_image_surface_get_stride(surface);
+
+  unsigned char* row = malloc(width * 3);
+  if(!row)
+    out_of_memory();
+
+  gboolean success = (fprintf(fp, "P6\n%i %i\n255\n", width, height) > 0);
+
+  /* cairo stores RGB24 as native endian 32 bit pixels */
+  int x, y;
+  for(y = 0; y < height && success; y++)
+  {
+    unsigned char* data = image + y * rowstride;
+    for(x = 0; x < width; x++)
+    {
+      row[x * 3]     = data[2];
+      row[x * 3 + 1] = data[1];
+      row[x * 3 + 2] = data[0];
+      data += 4;
+    }
+
+    if(fwrite(row, 3, width, fp) != (size_t) width)
+      success = FALSE;
+  }
+
+  free(row);
+
+  if(fclose(fp) != 0)
+    success = FALSE;
+
+  return success;
+}
+
+void
+start_export_job(ExportJob* job, int number_of_encoders)
+{
+  int number_of_extractors = get_number_of_export_workers();
+  int i;
+
+  job->number_of_encoders = number_of_encoders;
+  job->number_of_threads  = number_of_extractors + number_of_encoders;
+  job->extractors         = number_of_extractors;
+  job->running            = job->number_of_threads;
+
+  job->threads = malloc(sizeof(GThread*) * job->number_of_threads);
+  if(!job->threads)
+    out_of_memory();
+
+  /* extracted images are handed to the encoders through a bounded queue */
+  if(number_of_encoders > 0)
+  {
+    job->images = g_async_queue_new();
+    job->slots  = g_async_queue_new();
+    for(i = 0; i < EXPORT_QUEUE_SIZE; i++)
+      g_async_queue_push(job->slots, job);
+  }
+
+  Zathura.Export.jobs = g_list_append(Zathura.Export.jobs, job);
+  if(!Zathura.Export.progress)
+    Zathura.Export.progress = gdk_threads_add_timeout(250, cb_export_progress, NULL);
+
+  for(i = 0; i < job->number_of_threads; i++)
+  {
+    job->threads[i] = g_thread_create((i < number_of_extractors) ? export_worker : export_encoder, job, TRUE, NULL);
+    if(!job->threads[i])
+    {
+      /* give up, but keep the bookkeeping of the missing thread */
+      g_atomic_int_inc(&(job->errors));
+      cancel_export_job(job);
+
+      if(i < number_of_extractors)
+        finish_export_extractor(job);
+      else
+        finish_export_thread(job);
+    }
+  }
+
+  update_status_text();
+}
+
+void
+cancel_export_job(ExportJob* job)
+{
+  g_atomic_int_set(&(job->cancel), 1);
+
+  /* wake up the text workers that wait for their page to be written */
+  if(job->mutex)
+  {
+    g_mutex_lock(job->mutex);
+    g_cond_broadcast(job->cond);
+    g_mutex_unlock(job->mutex);
+  }
+}
+
+void
+finish_export_extractor(ExportJob* job)
+{
+  /* the last extractor tells the encoders to stop */
+  if(g_atomic_int_dec_and_test(&(job->extractors)) && job->images)
+  {
+    int i;
+    for(i = 0; i < job->number_of_encoders; i++)
+    {
+      ExportImage* image = malloc(sizeof(ExportImage));
+      if(!image)
+        out_of_memory();
+
+      image->surface = NULL;
+      image->file    = NULL;
+      g_async_queue_push(job->images, image);
+    }
+  }
+
+  finish_export_thread(job);
+}
+
+void
+finish_export_thread(ExportJob* job)
+{
+  if(g_atomic_int_dec_and_test(&(job->running)))
+    gdk_threads_add_idle(cb_export_finished, job);
+}
+
+void
+free_export_job(ExportJob* job)
+{
+  if(job->images)
+  {
+    ExportImage* image;
+    while((image = g_async_queue_try_pop(job->images)) != NULL)
+    {
+      if(image->surface)
+        cairo_surface_destroy(image->surface);
+      g_free(image->file);
+      free(image);
+    }
+    g_async_queue_unref(job->images);
+  }
+
+  if(job->slots)
+    g_async_queue_unref(job->slots);
+
+  if(job->texts)
+  {
+    int i;
+    for(i = 0; i < EXPORT_QUEUE_SIZE; i++)
+      g_free(job->texts[i]);
+    free(job->texts);
+  }
+
+  if(job->mutex)
+    g_mutex_free(job->mutex);
+  if(job->cond)
+    g_cond_free(job->cond);
+
+  free(job->threads);
+  g_free(job->uri);
+  g_free(job->password);
+  g_free(job->path);
+  g_free(job->name);
+  free(job);
+}
+
+void
+update_status_text(void)
+{
+  GString* text = g_string_new(Zathura.State.filename);
+
+  /* show the progress of running exports */
+  GList* list;
+  for(list = Zathura.Export.jobs; list; list = g_list_next(list))
+  {
+    ExportJob* job = (ExportJob*) list->data;
+    g_string_append_printf(text, "  [%s %i/%i]", job->description,
+        g_atomic_int_get(&(job->pages_done)), job->last_page - job->first_page + 1);
+  }
+
+  for(list = Zathura.Export.saves; list; list = g_list_next(list))
+  {
+    SaveJob* job = (SaveJob*) list->data;
+    g_string_append_printf(text, "  [Saving %i%%]", g_atomic_int_get(&(job->progress)));
+  }
+
+  gtk_label_set_markup((GtkLabel*) Zathura.Global.status_text, text->str);
+  g_string_free(text, TRUE);
+}
+
+/* thread implementation */
+void*
+search(void* parameter)
+{
+  Argument* argument = (Argument*) parameter;
+
+  static char* search_item;
+  static int direction;
+  static int next_page = 0;
+  gchar* old_query = NULL;
+  GList* results = NULL;
+
+  if(argument->n != NO_SEARCH)
+  {
+    /* search document */
+    if(argument->n)
+      direction = (argument->n == BACKWARD) ? -1 : 1;
+
+    if(argument->data)
+    {
+      if(search_item)
+        g_free(search_item);
+
+      search_item = g_strdup((char*) argument->data);
+    }
+    g_free(argument->data);
+    g_free(argument);
+
+    LOCK(pdf_obj_lock);
+    if(!Zathura.PDF.document || !search_item || !strlen(search_item))
+    {
+      g_static_mutex_unlock(&(Zathura.Lock.pdf_obj_lock));
+      LOCK(search_lock);
+      Zathura.Thread.search_thread_running = FALSE;
+      g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+      g_thread_exit(NULL);
+    }
+
+    old_query = Zathura.Search.query;
+
+    /* delete old results */
+    if(Zathura.Search.results)
+    {
+      g_list_free(Zathura.Search.results);
+      Zathura.Search.results = NULL;
+    }
+
+    Zathura.Search.query = g_strdup(search_item);
+
+    int number_of_pages = Zathura.PDF.number_of_pages;
+    int page_number     = Zathura.PDF.page_number;
+
+    g_static_mutex_unlock(&(Zathura.Lock.pdf_obj_lock));
+
+    gint64 trace = TRACE_BEGIN();
+
+    int page_counter = (g_strcmp0(old_query,search_item) == 0) ? 1 : 0;
+    for( ; page_counter <= number_of_pages; page_counter++)
+    {
+      LOCK(search_lock);
+      if(Zathura.Thread.search_thread_running == FALSE)
+      {
+        g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+        g_free(old_query);
+        g_thread_exit(NULL);
+      }
+      g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+      next_page = (number_of_pages + page_number +
+          page_counter * direction) % number_of_pages;
+
+      LOCK(pdflib_lock);
+      PopplerPage* page = poppler_document_get_page(Zathura.PDF.document, next_page);
+      g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+      if(!page)
+      {
+        g_free(old_query);
+        g_thread_exit(NULL);
+      }
+
+      LOCK(pdflib_lock);
+      results = poppler_page_find_text(page, search_item);
+      g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+      g_object_unref(page);
+
+      if(results)
+        break;
+    }
+
+    TRACE_END("search", "search", trace);
+  }
+  else
+  {
+    Zathura.Search.draw = TRUE;
+    g_free(argument->data);
+    g_free(argument);
+  }
+
+  /* draw results */
+  if(results)
+  {
+    gdk_threads_enter();
+
+    add_jump();
+    set_page(next_page);
+
+    if(Zathura.Search.results)
+      g_list_free(Zathura.Search.results);
+
+    Zathura.Search.results = results;
+    Zathura.Search.page    = next_page;
+    Zathura.Search.draw    = TRUE;
+    Zathura.Search.query   = g_strdup(search_item);
+
+    gdk_threads_leave();
+  }
+
+  LOCK(search_lock);
+  Zathura.Thread.search_thread_running = FALSE;
+  g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+  g_free(old_query);
+  g_thread_exit(NULL);
+  return NULL;
+}
+
+void
+grep_document(gpointer data, gpointer user_data)
+{
+  gchar*   file = (gchar*) data;
+  GrepJob* job  = (GrepJob*) user_data;
+
+  LOCK(search_lock);
+  gboolean running = Zathura.Thread.grep_thread_running;
+  g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+  gchar** pages = running ? get_document_text(file) : NULL;
+  if(!pages)
+  {
+    g_free(file);
+    return;
+  }
+
+  GList* hits = NULL;
+  int pattern_length = strlen(job->pattern);
+
+  /* the search is ASCII case insensitive, which keeps the offsets of the
+   * lowered and the original text in sync */
+  int i;
+  for(i = 0; pages[i] && running; i++)
+  {
+    LOCK(search_lock);
+    running = Zathura.Thread.grep_thread_running;
+    g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+    gchar* text  = g_ascii_strdown(pages[i], -1);
+    gchar* match = strstr(text, job->pattern);
+
+    if(match)
+    {
+      gchar* start = pages[i] + (match - text);
+      gchar* end   = start + pattern_length;
+      int j;
+
+      for(j = 0; j < 30 && start > pages[i]; j++)
+        start = g_utf8_find_prev_char(pages[i], start);
+      for(j = 0; j < 30 && *end; j++)
+        end = g_utf8_find_next_char(end, NULL);
+
+      GrepHit* hit = malloc(sizeof(GrepHit));
+      if(!hit)
+        out_of_memory();
+
+      hit->file    = g_strdup(file);
+      hit->page    = i;
+      hit->context = g_strndup(start, end - start);
+      g_strdelimit(hit->context, "\n\r\t", ' ');
+
+      hits = g_list_prepend(hits, hit);
+    }
+
+    g_free(text);
+  }
+
+  g_mutex_lock(job->lock);
+  job->hits = g_list_concat(hits, job->hits);
+  g_mutex_unlock(job->lock);
+
+  g_strfreev(pages);
+  g_free(file);
+}
+
+void*
+grep(void* parameter)
+{
+  GrepJob* job = (GrepJob*) parameter;
+
+  GDir* dir = g_dir_open(job->directory, 0, NULL);
+  gboolean opened = (dir != NULL);
+  if(dir)
+  {
+    GThreadPool* pool = g_thread_pool_new(grep_document, job, get_number_of_workers(), TRUE, NULL);
+
+    const char* name;
+    while((name = g_dir_read_name(dir)) != NULL)
+    {
+      gchar* lower_name = g_ascii_strdown(name, -1);
+      if(g_str_has_suffix(lower_name, ".pdf"))
+        g_thread_pool_push(pool, g_build_filename(job->directory, name, NULL), NULL);
+      g_free(lower_name);
+    }
+
+    g_dir_close(dir);
+    g_thread_pool_free(pool, FALSE, TRUE);
+  }
+
+  job->hits = g_list_sort(job->hits, compare_grep_hits);
+
+  LOCK(search_lock);
+  gboolean cancelled = !Zathura.Thread.grep_thread_running;
+  Zathura.Thread.grep_thread_running = FALSE;
+  g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+  gdk_threads_enter();
+
+  if(cancelled)
+    free_grep_hits(job->hits);
+  else if(!opened)
+    notify(ERROR, "Could not open directory");
+  else if(!job->hits)
+    notify(WARNING, "No matches found");
+  else
+  {
+    free_grep_hits(Zathura.Grep.hits);
+    Zathura.Grep.hits = job->hits;
+
+    /* present the hits in the completion unless the inputbar has been used
+     * for something else in the meantime */
+    gboolean waiting = (Zathura.Global.mode == NORMAL || Zathura.Global.mode == FULLSCREEN)
+      && !gtk_widget_is_focus(GTK_WIDGET(Zathura.UI.inputbar))
+      && !strcmp(gtk_entry_get_text(Zathura.UI.inputbar), job->message);
+
+    if(waiting)
+    {
+      Argument argument = { 0, ":grep " };
+      sc_focus_inputbar(&argument);
+
+      argument.n = NEXT;
+      isc_completion(&argument);
+    }
+    else
+    {
+      gchar* message = g_strdup_printf("%i matches found, use :grep<Tab> to show them",
+          g_list_length(job->hits));
+      notify(DEFAULT, message);
+      g_free(message);
+    }
+  }
+
+  gdk_threads_leave();
+
+  g_mutex_free(job->lock);
+  g_free(job->pattern);
+  g_free(job->directory);
+  g_free(job);
+
+  g_thread_exit(NULL);
+  return NULL;
+}
+
+void
+render_job(gpointer data, gpointer user_data)
+{
+  RenderJob* job = (RenderJob*) data;
+
+  /* the document is being closed */
+  LOCK(render_lock);
+  gboolean stop = Zathura.Render.stop;
+  g_static_mutex_unlock(&(Zathura.Lock.render_lock));
+
+  if(stop)
+  {
+    free(job);
+    return;
+  }
+
+  cairo_surface_t* surface = render_cache_lookup(job->page_id, job->scale, job->rotate, job->recolor);
+  if(!surface)
+  {
+    surface = render_page(Zathura.PDF.pages[job->page_id]->page, job->scale, job->rotate, job->recolor, TRUE);
+    if(!job->pin)
+      render_cache_insert(job->page_id, job->scale, job->rotate, job->recolor, surface);
+  }
+
+  if(job->pin)
+    render_cache_pin(job->page_id, job->scale, job->rotate, job->recolor, surface);
+
+  cairo_surface_destroy(surface);
+  free(job);
+}
+
+void*
+write_bookmarks(void* parameter)
+{
+  GMutex* mutex = g_static_mutex_get_mutex(&(Zathura.Lock.bookmarks_lock));
+  g_mutex_lock(mutex);
+
+  while(TRUE)
+  {
+    while(!Zathura.Bookmarks.stop && !Zathura.Bookmarks.snapshot
+        && g_queue_is_empty(Zathura.Bookmarks.queue))
+      g_cond_wait(Zathura.Bookmarks.cond, mutex);
+
+    if(!Zathura.Bookmarks.snapshot && g_queue_is_empty(Zathura.Bookmarks.queue))
+      break;
+
+    /* take everything that was queued so far */
+    GString* batch = g_string_new("");
+    gchar* record;
+    while((record = g_queue_pop_head(Zathura.Bookmarks.queue)))
+    {
+      g_string_append(batch, record);
+      Zathura.Bookmarks.writing = g_list_append(Zathura.Bookmarks.writing, record);
+    }
+    g_hash_table_remove_all(Zathura.Bookmarks.queued_positions);
+
+    gchar* snapshot = Zathura.Bookmarks.snapshot;
+    ino_t  inode    = Zathura.Bookmarks.snapshot_inode;
+    off_t  offset   = Zathura.Bookmarks.snapshot_offset;
+    Zathura.Bookmarks.snapshot = NULL;
+    g_mutex_unlock(mutex);
+
+    int fd         = -1;
+    gchar* tail    = NULL;
+    gboolean saved = FALSE;
+    struct stat info;
+
+    /* all instances append and compact under the lock of the file */
+    if(lock_bookmarks_file())
+    {
+      /* only a file whose records are all in the index can be compacted */
+      if(snapshot && fstat(Zathura.Bookmarks.fd, &info) == 0 && info.st_ino == inode
+          && info.st_size >= offset)
+      {
+        /* records other instances appended since the last read; an
+         * incomplete record at the end is discarded by the compaction */
+        tail = read_bookmarks_tail(offset, info.st_size);
+
+        gchar* tmp_file = g_strdup_printf("%s.tmp", Zathura.Bookmarks.file);
+        FILE* file = fopen(tmp_file, "w");
+
+        gboolean success = file && fputs(snapshot, file) >= 0 && fputs(tail, file) >= 0
+          && fputs(batch->str, file) >= 0;
+        if(file)
+          success = (fflush(file) == 0) && (fsync(fileno(file)) == 0) && success;
+        if(file && fclose(file) != 0)
+          success = FALSE;
+
+        if(success && rename(tmp_file, Zathura.Bookmarks.file) == 0 && stat(Zathura.Bookmarks.file, &info) == 0)
+        {
+          fd    = open(Zathura.Bookmarks.file, O_RDWR | O_APPEND);
+          saved = TRUE;
+        }
+        else
+          g_unlink(tmp_file);
+
+        g_free(tmp_file);
+      }
+
+      /* a single write keeps the records intact if the lock is not
+       * supported by the file system */
+      if(!saved && batch->len > 0)
+      {
+        char last = '\n';
+        if(fstat(Zathura.Bookmarks.fd, &info) == 0 && info.st_size > 0
+            && pread(Zathura.Bookmarks.fd, &last, 1, info.st_size - 1) == 1 && last != '\n')
+          g_string_prepend_c(batch, '\n');
+
+        if(write(Zathura.Bookmarks.fd, batch->str, batch->len) == (ssize_t) batch->len)
+          fsync(Zathura.Bookmarks.fd);
+      }
+
+      flock(Zathura.Bookmarks.fd, LOCK_UN);
+
+      if(saved)
+      {
+        close(Zathura.Bookmarks.fd);
+        Zathura.Bookmarks.fd = fd;
+      }
+    }
+
+    g_free(snapshot);
+    g_string_free(batch, TRUE);
+    g_mutex_lock(mutex);
+
+    if(saved)
+    {
+      /* the index contains everything that is in the new file once the
+       * records appended since the snapshot are applied again, followed by
+       * our own newer ones */
+      gchar** lines = g_strsplit(tail, "\n", -1);
+      int i;
+      for(i = 0; lines[i] && lines[i + 1]; i++)
+      {
+        apply_bookmark_record(lines[i]);
+        Zathura.Bookmarks.records++;
+      }
+      g_strfreev(lines);
+
+      GList* list;
+      for(list = Zathura.Bookmarks.writing; list; list = g_list_next(list))
+      {
+        gchar* line = g_strndup(list->data, strlen(list->data) - 1);
+        apply_bookmark_record(line);
+        g_free(line);
+      }
+      for(list = Zathura.Bookmarks.queue->head; list; list = g_list_next(list))
+      {
+        gchar* line = g_strndup(list->data, strlen(list->data) - 1);
+        apply_bookmark_record(line);
+        g_free(line);
+      }
+
+      Zathura.Bookmarks.inode  = info.st_ino;
+      Zathura.Bookmarks.offset = info.st_size;
+    }
+
+    g_free(tail);
+
+    GList* list;
+    for(list = Zathura.Bookmarks.writing; list; list = g_list_next(list))
+      g_free(list->data);
+    g_list_free(Zathura.Bookmarks.writing);
+    Zathura.Bookmarks.writing = NULL;
+  }
+
+  g_mutex_unlock(mutex);
+
+  g_thread_exit(NULL);
+  return NULL;
+}
+
+gboolean
+lock_bookmarks_file(void)
+{
+  while(TRUE)
+  {
+    if(Zathura.Bookmarks.fd == -1)
+      Zathura.Bookmarks.fd = open(Zathura.Bookmarks.file, O_RDWR | O_APPEND | O_CREAT, 0600);
+    if(Zathura.Bookmarks.fd == -1)
+      return FALSE;
+
+    if(flock(Zathura.Bookmarks.fd, LOCK_EX) != 0)
+    {
+      if(errno == EINTR)
+        continue;
+
+      /* appends still work without the lock */
+      return errno == ENOLCK || errno == EOPNOTSUPP;
+    }
+
+    /* another instance may have replaced the file while we waited */
+    struct stat locked, current;
+    if(fstat(Zathura.Bookmarks.fd, &locked) == 0 && stat(Zathura.Bookmarks.file, &current) == 0
+        && locked.st_ino == current.st_ino)
+      return TRUE;
+
+    flock(Zathura.Bookmarks.fd, LOCK_UN);
+    close(Zathura.Bookmarks.fd);
+    Zathura.Bookmarks.fd = -1;
+  }
+}
+
+gchar*
+read_bookmarks_tail(off_t offset, off_t size)
+{
+  size_t length = size - offset;
+  gchar* tail   = g_malloc(length + 1);
+  size_t bytes  = 0;
+
+  while(bytes < length)
+  {
+    ssize_t n = pread(Zathura.Bookmarks.fd, tail + bytes, length - bytes, offset + bytes);
+    if(n <= 0)
+      break;
+    bytes += n;
+  }
+
+  /* an incomplete record at the end is left out */
+  tail[bytes] = '\0';
+  char* end = strrchr(tail, '\n');
+  if(end)
+    *(end + 1) = '\0';
+  else
+    tail[0] = '\0';
+
+  return tail;
+}
+
+gboolean
+scan_index(PopplerIndexIter* index_iter, GPtrArray* actions)
+{
+  /* called with pdflib_lock held, which is released every few entries so
+   * that rendering can go on while a large outline is scanned */
+  do
+  {
+    PopplerAction* action = poppler_index_iter_get_action(index_iter);
+    if(action)
+    {
+      g_ptr_array_add(actions, action);
+
+      if(actions->len % 64 == 0)
+      {
+        g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+        LOCK(search_lock);
+        gboolean cancelled = !Zathura.Thread.scan_thread_running;
+        g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+        LOCK(pdflib_lock);
+        if(cancelled)
+          return FALSE;
+      }
+    }
+
+    PopplerIndexIter* child = poppler_index_iter_get_child(index_iter);
+    if(child)
+    {
+      gboolean finished = scan_index(child, actions);
+      poppler_index_iter_free(child);
+
+      if(!finished)
+        return FALSE;
+    }
+  } while(poppler_index_iter_next(index_iter));
+
+  return TRUE;
+}
+
+#if POPPLER_CHECK_VERSION(0,78,0)
+gboolean
+scan_add_destination(gpointer key, gpointer value, gpointer data)
+{
+  PopplerDest* dest = (PopplerDest*) value;
+  g_hash_table_insert((GHashTable*) data, g_strdup((gchar*) key), GINT_TO_POINTER(dest->page_num));
+
+  return FALSE;
+}
+#else
+void
+scan_add_action(PopplerAction* action, GHashTable* destinations)
+{
+  if(action && action->type == POPPLER_ACTION_GOTO_DEST && action->goto_dest.dest
+      && action->goto_dest.dest->type == POPPLER_DEST_NAMED)
+    g_hash_table_insert(destinations, g_strdup(action->goto_dest.dest->named_dest), NULL);
+}
+#endif
+
+void*
+read_directory(void* parameter)
+{
+  DirectoryListing* result = (DirectoryListing*) parameter;
+  gchar* path              = result->path;
+
+  result->entries = g_ptr_array_new_with_free_func(g_free);
+
+  GDir* dir = g_dir_open(path, 0, NULL);
+  if(dir)
+  {
+    char* name = NULL;
+    while((name = (char*) g_dir_read_name(dir)) != NULL)
+    {
+      char* d_name = g_filename_display_name(name);
+      char* d      = g_strdup_printf("%s%s", path, name);
+
+      /* directories are listed with a trailing slash */
+      if(g_file_test(d, G_FILE_TEST_IS_DIR))
+      {
+        gchar* subdir = d_name;
+        d_name = g_strdup_printf("%s/", subdir);
+        g_free(subdir);
+      }
+
+      g_ptr_array_add(result->entries, d_name);
+      g_free(d);
+    }
+
+    g_dir_close(dir);
+  }
+
+  gdk_threads_add_idle(cb_directory_read, result);
+
+  return NULL;
+}
+
+void*
+read_printers(void* parameter)
+{
+  gchar* command = (gchar*) parameter;
+  GString* output = g_string_new("");
+
+  FILE* fp = popen(command, "r");
+  if(fp)
+  {
+    char buffer[BUFSIZ];
+    size_t length;
+
+    while((length = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+      g_string_append_len(output, buffer, length);
+
+    pclose(fp);
+  }
+
+  gchar** printers = g_strsplit(output->str, "\n", -1);
+  g_string_free(output, TRUE);
+  g_free(command);
+
+  gdk_threads_add_idle(cb_printers_read, printers);
+
+  return NULL;
+}
+
+void*
+export_worker(void* parameter)
+{
+  ExportJob* job = (ExportJob*) parameter;
+
+  /* poppler documents are not shared between threads, so every worker
+   * reads from its own one */
+  PopplerDocument* document = poppler_document_new_from_file(job->uri, job->password, NULL);
+
+  if(document)
+  {
+    int page;
+    while(!g_atomic_int_get(&(job->cancel)) &&
+        (page = g_atomic_int_exchange_and_add(&(job->next_page), 1)) <= job->last_page)
+    {
+      job->export_page(job, document, page);
+      g_atomic_int_inc(&(job->pages_done));
+    }
+
+    g_object_unref(document);
+  }
+  else
+    g_atomic_int_inc(&(job->errors));
+
+  finish_export_extractor(job);
+
+  return NULL;
+}
+
+void*
+export_encoder(void* parameter)
+{
+  ExportJob*   job = (ExportJob*) parameter;
+  ExportImage* image;
+
+  while((image = (ExportImage*) g_async_queue_pop(job->images))->surface)
+  {
+    if(!g_atomic_int_get(&(job->cancel)))
+    {
+      if(cairo_surface_write_to_png(image->surface, image->file) == CAIRO_STATUS_SUCCESS)
+        g_atomic_int_inc(&(job->written));
+      else
+        g_atomic_int_inc(&(job->errors));
+    }
+
+    cairo_surface_destroy(image->surface);
+    g_free(image->file);
+    free(image);
+
+    /* make room for the next image */
+    g_async_queue_push(job->slots, job);
+  }
+
+  free(image);
+  finish_export_thread(job);
+
+  return NULL;
+}
+
+void
+export_page_images(ExportJob* job, PopplerDocument* document, int page_number)
+{
+  PopplerPage* page = poppler_document_get_page(document, page_number);
+  if(!page)
+  {
+    g_atomic_int_inc(&(job->errors));
+    return;
+  }
+
+  GList* image_list = poppler_page_get_image_mapping(page);
+  GList* images;
+
+  for(images = image_list; images && !g_atomic_int_get(&(job->cancel)); images = g_list_next(images))
+  {
+    PopplerImageMapping* image_mapping = (PopplerImageMapping*) images->data;
+    cairo_surface_t*     surface       = poppler_page_get_image(page, image_mapping->image_id);
+
+    if(!surface)
+      continue;
+
+    /* wait until the encoders have caught up */
+    g_async_queue_pop(job->slots);
+
+    ExportImage* image = malloc(sizeof(ExportImage));
+    if(!image)
+      out_of_memory();
+
+    image->surface = surface;
+    image->file    = g_strdup_printf("%s%s_p%i_i%i.png", job->path, job->name,
+        page_number + 1, image_mapping->image_id);
+
+    g_async_queue_push(job->images, image);
+  }
+
+  poppler_page_free_image_mapping(image_list);
+  g_object_unref(page);
+}
+
+void
+export_page_raster(ExportJob* job, PopplerDocument* document, int page_number)
+{
+  PopplerPage* page = poppler_document_get_page(document, page_number);
+  if(!page)
+  {
+    g_atomic_int_inc(&(job->errors));
+    return;
+  }
+
+  /* the page is written before the next one is rendered */
+  cairo_surface_t* surface = render_page(page, job->scale, job->rotate, job->recolor, FALSE);
+  g_object_unref(page);
+
+  /* the page might be too large for an image surface */
+  if(cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+  {
+    g_atomic_int_inc(&(job->errors));
+    cairo_surface_destroy(surface);
+    return;
+  }
+
+  int digits  = snprintf(NULL, 0, "%i", poppler_document_get_n_pages(document));
+  gchar* file = g_strdup_printf("%s%s_p%0*i.%s", job->path, job->name, digits,
+      page_number + 1, job->ppm ? "ppm" : "png");
+
+  gboolean written = job->ppm ? write_ppm(surface, file) :
+    (cairo_surface_write_to_png(surface, file) == CAIRO_STATUS_SUCCESS);
+
+  g_atomic_int_inc(written ? &(job->written) : &(job->errors));
+
+  cairo_surface_destroy(surface);
+  g_free(file);
+}
+
+void
+export_page_text(ExportJob* job, PopplerDocument* document, int page_number)
+{
+  /* do not get too far ahead of the page that is written next */
+  g_mutex_lock(job->mutex);
+  while(page_number >= job->next_write + EXPORT_QUEUE_SIZE && !g_atomic_int_get(&(job->cancel)))
+    g_cond_wait(job->cond, job->mutex);
+  g_mutex_unlock(job->mutex);
+
+  if(g_atomic_int_get(&(job->cancel)))
+    return;
+
+  gchar* text = NULL;
+  PopplerPage* page = poppler_document_get_page(document, page_number);
+  if(page)
+  {
+    text = get_page_text(page);
+    g_object_unref(page);
+  }
+  else
+    g_atomic_int_inc(&(job->errors));
+
+  g_mutex_lock(job->mutex);
+
+  job->texts[page_number % EXPORT_QUEUE_SIZE] = text ? text : g_strdup("");
+
+  /* write all pages that are ready in page order; pages are separated by
+   * form feeds like pdftotext does */
+  while(job->next_write <= job->last_page && job->texts[job->next_write % EXPORT_QUEUE_SIZE])
+  {
+    int index = job->next_write % EXPORT_QUEUE_SIZE;
+
+    if(fputs(job->texts[index], job->output) < 0 || fputc('\f', job->output) == EOF)
+      g_atomic_int_inc(&(job->errors));
+    else
+      g_atomic_int_inc(&(job->written));
+
+    g_free(job->texts[index]);
+    job->texts[index] = NULL;
+    job->next_write++;
+  }
+
+  g_cond_broadcast(job->cond);
+  g_mutex_unlock(job->mutex);
+}
+
+void*
+save_document(void* parameter)
+{
+  SaveJob* job = (SaveJob*) parameter;
+  struct stat source_info, target_info;
+
+  gboolean exists = (stat(job->target, &target_info) == 0);
+
+  /* writing the document onto itself would truncate it */
+  if(exists && stat(job->source, &source_info) == 0 && target_info.st_dev == source_info.st_dev
+      && target_info.st_ino == source_info.st_ino)
+  {
+    job->success = TRUE;
+    gdk_threads_add_idle(cb_save_finished, job);
+    return NULL;
+  }
+
+  /* the document is written next to the target and only replaces it once
+   * it is complete */
+  int fd = g_mkstemp_full(job->tmp, O_WRONLY, 0644);
+  if(fd == -1)
+  {
+    job->error = g_strdup(g_strerror(errno));
+    gdk_threads_add_idle(cb_save_finished, job);
+    return NULL;
+  }
+
+  if(exists)
+    fchmod(fd, target_info.st_mode & 07777);
+
+  /* zathura never modifies the document, so the file is simply copied;
+   * poppler only serializes the document if that is not possible */
+  job->success = copy_document(job, fd);
+
+  if(!job->success && !g_atomic_int_get(&(job->cancel)))
+  {
+    GError* error = NULL;
+    gchar*  uri   = g_filename_to_uri(job->tmp, NULL, NULL);
+
+    LOCK(pdflib_lock);
+    job->success = uri && poppler_document_save(job->document, uri, &error);
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+    g_free(uri);
+
+    if(!job->success)
+    {
+      g_free(job->error);
+      job->error = g_strdup(error ? error->message : "unknown error");
+      if(error)
+        g_error_free(error);
+    }
+  }
+
+  if(job->success && g_atomic_int_get(&(job->cancel)))
+  {
+    job->success = FALSE;
+    job->error   = g_strdup("cancelled");
+  }
+
+  if(job->success && rename(job->tmp, job->target) != 0)
+  {
+    job->success = FALSE;
+    job->error   = g_strdup(g_strerror(errno));
+  }
+
+  if(!job->success)
+    g_unlink(job->tmp);
+
+  gdk_threads_add_idle(cb_save_finished, job);
+
+  return NULL;
+}
+
+gboolean
+copy_document(SaveJob* job, int target)
+{
+  struct stat info;
+
+  int source = open(job->source, O_RDONLY);
+  if(source < 0 || fstat(source, &info) != 0)
+  {
+    if(source >= 0)
+      close(source);
+    close(target);
+    return FALSE;
+  }
+
+  gboolean success = FALSE;
+  off_t    copied  = 0;
+
+#ifdef FICLONE
+  /* share the extents if the file system supports it */
+  if(ioctl(target, FICLONE, source) == 0)
+  {
+    copied  = info.st_size;
+    success = TRUE;
+  }
+#endif
+
+#ifdef SYS_copy_file_range
+  /* let the kernel copy the data */
+  while(!success && !g_atomic_int_get(&(job->cancel)))
+  {
+    long length = syscall(SYS_copy_file_range, source, NULL, target, NULL, (size_t) (8 << 20), 0);
+    if(length < 0)
+      break;
+
+    if(length == 0)
+    {
+      success = TRUE;
+      break;
+    }
+
+    copied += length;
+    g_atomic_int_set(&(job->progress), info.st_size ? (int) (copied * 100 / info.st_size) : 100);
+  }
+#endif
+
+  /* copy_file_range might not be supported between these file systems */
+  if(!success && !g_atomic_int_get(&(job->cancel)) && lseek(source, copied, SEEK_SET) == copied)
+  {
+    char buffer[1 << 16];
+    ssize_t length;
+
+    while(!g_atomic_int_get(&(job->cancel)) && (length = read(source, buffer, sizeof(buffer))) > 0)
+    {
+      ssize_t offset = 0;
+      while(offset < length)
+      {
+        ssize_t n = write(target, buffer + offset, length - offset);
+        if(n < 0)
+          break;
+        offset += n;
+      }
+
+      if(offset < length)
+      {
+        length = -1;
+        break;
+      }
+
+      copied += length;
+      g_atomic_int_set(&(job->progress), info.st_size ? (int) (copied * 100 / info.st_size) : 100);
+    }
 
-  while(el && el->next)
-    el = el->next;
+    success = (length == 0);
+  }
 
-  CompletionElement* new_element = malloc(sizeof(CompletionElement));
-  if(!new_element)
-    out_of_memory();
+  close(source);
+  if(success && fsync(target) != 0)
+    success = FALSE;
+  if(close(target) != 0)
+    success = FALSE;
 
-  new_element->value       = name ? g_strdup(name) : NULL;
-  new_element->description = description ?  g_strdup(description) : NULL;
-  new_element->next        = NULL;
+  if(!success && !job->error)
+    job->error = g_strdup(g_atomic_int_get(&(job->cancel)) ? "cancelled" : g_strerror(errno));
 
-  if(el)
-    el->next = new_element;
-  else
-    group->elements = new_element;
+  return success;
 }
 
-
-/* thread implementation */
 void*
-search(void* parameter)
+scan_document(void* parameter)
 {
-  Argument* argument = (Argument*) parameter;
+  PopplerDocument* document     = (PopplerDocument*) parameter;
+  GHashTable*      destinations = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  GPtrArray*       actions      = g_ptr_array_new();
+  gboolean         cancelled    = FALSE;
+  int              i;
 
-  static char* search_item;
-  static int direction;
-  static int next_page = 0;
-  gchar* old_query = NULL;
-  GList* results = NULL;
+  /* collect the outline in document order */
+  LOCK(pdflib_lock);
+  PopplerIndexIter* index_iter = poppler_index_iter_new(document);
+  if(index_iter)
+  {
+    cancelled = !scan_index(index_iter, actions);
+    poppler_index_iter_free(index_iter);
+  }
+  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
-  if(argument->n != NO_SEARCH)
+#if POPPLER_CHECK_VERSION(0,78,0)
+  GTree* tree = NULL;
+  if(!cancelled)
   {
-    /* search document */
-    if(argument->n)
-      direction = (argument->n == BACKWARD) ? -1 : 1;
+    LOCK(pdflib_lock);
+    tree = poppler_document_create_dests_tree(document);
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+  }
 
-    if(argument->data)
-    {
-      if(search_item)
-        g_free(search_item);
+  if(tree)
+  {
+    g_tree_foreach(tree, scan_add_destination, destinations);
+    g_tree_destroy(tree);
+  }
+#else
+  /* collect the named destinations of the outline and of the links */
+  for(i = 0; i < actions->len; i++)
+    scan_add_action(g_ptr_array_index(actions, i), destinations);
 
-      search_item = g_strdup((char*) argument->data);
-    }
-    g_free(argument->data);
-    g_free(argument);
+  LOCK(pdflib_lock);
+  int number_of_pages = poppler_document_get_n_pages(document);
+  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
-    g_static_mutex_lock(&(Zathura.Lock.pdf_obj_lock));
-    if(!Zathura.PDF.document || !search_item || !strlen(search_item))
-    {
-      g_static_mutex_unlock(&(Zathura.Lock.pdf_obj_lock));
-      g_static_mutex_lock(&(Zathura.Lock.search_lock));
-      Zathura.Thread.search_thread_running = FALSE;
-      g_static_mutex_unlock(&(Zathura.Lock.search_lock));
-      g_thread_exit(NULL);
-    }
+  for(i = 0; i < number_of_pages && !cancelled; i++)
+  {
+    LOCK(pdflib_lock);
+    PopplerPage* page = poppler_document_get_page(document, i);
+    GList* link_list  = page ? poppler_page_get_link_mapping(page) : NULL;
 
-    old_query = Zathura.Search.query;
+    GList* links;
+    for(links = link_list; links; links = g_list_next(links))
+      scan_add_action(((PopplerLinkMapping*) links->data)->action, destinations);
 
-    /* delete old results */
-    if(Zathura.Search.results)
+    poppler_page_free_link_mapping(link_list);
+    if(page)
+      g_object_unref(page);
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+    LOCK(search_lock);
+    cancelled = !Zathura.Thread.scan_thread_running;
+    g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+  }
+
+  /* resolve them */
+  GList* names = g_hash_table_get_keys(destinations);
+  GList* list;
+  for(list = names; list && !cancelled; list = g_list_next(list))
+  {
+    LOCK(pdflib_lock);
+    PopplerDest* dest = poppler_document_find_dest(document, (gchar*) list->data);
+    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+    if(dest)
     {
-      g_list_free(Zathura.Search.results);
-      Zathura.Search.results = NULL;
+      g_hash_table_insert(destinations, g_strdup((gchar*) list->data), GINT_TO_POINTER(dest->page_num));
+      poppler_dest_free(dest);
     }
 
-    Zathura.Search.query = g_strdup(search_item);
-
-    int number_of_pages = Zathura.PDF.number_of_pages;
-    int page_number     = Zathura.PDF.page_number;
+    LOCK(search_lock);
+    cancelled = !Zathura.Thread.scan_thread_running;
+    g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+  }
+  g_list_free(names);
+#endif
 
-    g_static_mutex_unlock(&(Zathura.Lock.pdf_obj_lock));
+  /* flatten the outline into sections sorted by their first page */
+  SectionIndex* sections = malloc(sizeof(SectionIndex));
+  if(!sections)
+    out_of_memory();
 
-    int page_counter = (g_strcmp0(old_query,search_item) == 0) ? 1 : 0;
-    for( ; page_counter <= number_of_pages; page_counter++)
-    {
-      g_static_mutex_lock(&(Zathura.Lock.search_lock));
-      if(Zathura.Thread.search_thread_running == FALSE)
-      {
-        g_static_mutex_unlock(&(Zathura.Lock.search_lock));
-        g_free(old_query);
-        g_thread_exit(NULL);
-      }
-      g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+  sections->sections           = malloc(sizeof(Section) * (actions->len + 1));
+  sections->number_of_sections = 0;
+  if(!sections->sections)
+    out_of_memory();
 
-      next_page = (number_of_pages + page_number +
-          page_counter * direction) % number_of_pages;
+  for(i = 0; i < actions->len; i++)
+  {
+    PopplerAction* action = g_ptr_array_index(actions, i);
 
-      g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-      PopplerPage* page = poppler_document_get_page(Zathura.PDF.document, next_page);
-      g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+    if(action->type == POPPLER_ACTION_GOTO_DEST && action->goto_dest.dest && action->any.title)
+    {
+      PopplerDest* dest = action->goto_dest.dest;
+      int page_number   = (dest->type == POPPLER_DEST_NAMED) ?
+        GPOINTER_TO_INT(g_hash_table_lookup(destinations, dest->named_dest)) : dest->page_num;
 
-      if(!page)
+      if(page_number > 0)
       {
-        g_free(old_query);
-        g_thread_exit(NULL);
+        Section* section = &(sections->sections[sections->number_of_sections]);
+        section->page    = page_number - 1;
+        section->order   = sections->number_of_sections;
+        section->title   = g_markup_escape_text(action->any.title, -1);
+        sections->number_of_sections++;
       }
+    }
 
-      g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-      results = poppler_page_find_text(page, search_item);
-      g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+    poppler_action_free(action);
+  }
+  g_ptr_array_free(actions, TRUE);
 
-      g_object_unref(page);
+  qsort(sections->sections, sections->number_of_sections, sizeof(Section), compare_sections);
 
-      if(results)
-        break;
-    }
-  }
-  else
+  /* publish the results, lookups do not need to lock them */
+  if(cancelled)
   {
-    Zathura.Search.draw = TRUE;
-    g_free(argument->data);
-    g_free(argument);
+    g_hash_table_destroy(destinations);
+    free_sections(sections);
   }
-
-  /* draw results */
-  if(results)
+  else
   {
-    gdk_threads_enter();
-
-    set_page(next_page);
-
-    if(Zathura.Search.results)
-      g_list_free(Zathura.Search.results);
-
-    Zathura.Search.results = results;
-    Zathura.Search.page    = next_page;
-    Zathura.Search.draw    = TRUE;
-    Zathura.Search.query   = g_strdup(search_item);
-
-    gdk_threads_leave();
+    g_atomic_pointer_set(&Zathura.PDF.destinations, destinations);
+    g_atomic_pointer_set(&Zathura.PDF.sections, sections);
+    gdk_threads_add_idle(cb_update_status, NULL);
   }
 
-  g_static_mutex_lock(&(Zathura.Lock.search_lock));
-  Zathura.Thread.search_thread_running = FALSE;
-  g_static_mutex_unlock(&(Zathura.Lock.search_lock));
-
-  g_free(old_query);
   g_thread_exit(NULL);
   return NULL;
 }
@@ -2170,6 +5438,13 @@ sc_abort(Argument* argument)
   if(!Zathura.Global.show_inputbar)
     gtk_widget_hide(GTK_WIDGET(Zathura.UI.inputbar));
 
+  /* Cancel running exports */
+  GList* list;
+  for(list = Zathura.Export.jobs; list; list = g_list_next(list))
+    cancel_export_job((ExportJob*) list->data);
+  for(list = Zathura.Export.saves; list; list = g_list_next(list))
+    g_atomic_int_set(&(((SaveJob*) list->data)->cancel), 1);
+
   /* Set back to normal mode */
   change_mode(NORMAL);
   switch_view(Zathura.UI.document);
@@ -2197,7 +5472,7 @@ sc_adjust_window(Argument* argument)
 
   view_size  = gtk_adjustment_get_page_size(adjustment);
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+  LOCK(pdflib_lock);
   poppler_page_get_size(Zathura.PDF.pages[Zathura.PDF.page_number]->page, &page_width, &page_height);
   g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
@@ -2278,44 +5553,32 @@ sc_follow(Argument* argument)
   if(!Zathura.PDF.document)
     return;
 
-  Page* current_page = Zathura.PDF.pages[Zathura.PDF.page_number];
-  int link_id = 1;
-
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-  GList *link_list = poppler_page_get_link_mapping(current_page->page);
-  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
-  link_list = g_list_reverse(link_list);
+  PageLinks* links = get_page_links(Zathura.PDF.page_number);
 
-  if(g_list_length(link_list) <= 0)
+  if(links->number_of_links <= 0)
     return;
 
-  GList *links;
-  for(links = link_list; links; links = g_list_next(links))
+  cairo_t *cairo = create_page_context();
+  cairo_select_font_face(cairo, font, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+  cairo_set_font_size(cairo, 10);
+
+  int i;
+  for(i = 0; i < links->number_of_links; i++)
   {
-    PopplerLinkMapping *link_mapping = (PopplerLinkMapping*) links->data;
-    PopplerRectangle* link_rectangle = &link_mapping->area;
-    PopplerAction            *action = link_mapping->action;
+    PopplerRectangle* device = &(links->links[i].device);
 
-    /* only handle URI and internal links */
-    if(action->type == POPPLER_ACTION_URI || action->type == POPPLER_ACTION_GOTO_DEST)
-    {
-      highlight_result(Zathura.PDF.page_number, link_rectangle);
+    highlight_result(Zathura.PDF.page_number, &(links->links[i].area));
 
-      /* draw text */
-      recalc_rectangle(Zathura.PDF.page_number, link_rectangle);
-      cairo_t *cairo = cairo_create(Zathura.PDF.surface);
-      cairo_select_font_face(cairo, font, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-      cairo_set_font_size(cairo, 10);
-      cairo_move_to(cairo, link_rectangle->x1 + 1, link_rectangle->y1 - 1);
-      char* link_number = g_strdup_printf("%i", link_id++);
-      cairo_show_text(cairo, link_number);
-      cairo_destroy(cairo);
-      g_free(link_number);
-    }
+    /* draw text */
+    cairo_set_source_rgb(cairo, 0, 0, 0);
+    cairo_move_to(cairo, device->x1 + 1, device->y1 - 1);
+    char* link_number = g_strdup_printf("%i", i + 1);
+    cairo_show_text(cairo, link_number);
+    g_free(link_number);
   }
 
+  cairo_destroy(cairo);
   gtk_widget_queue_draw(Zathura.UI.drawing_area);
-  poppler_page_free_link_mapping(link_list);
 
   /* replace default inputbar handler */
   g_signal_handler_disconnect((gpointer) Zathura.UI.inputbar, Zathura.Handler.inputbar_activate);
@@ -2325,6 +5588,44 @@ sc_follow(Argument* argument)
   sc_focus_inputbar(argument);
 }
 
+void
+sc_jump(Argument* argument)
+{
+  if(!Zathura.PDF.document || !Zathura.Jumps.list)
+    return;
+
+  if(argument->n == BACKWARD)
+  {
+    if(Zathura.Jumps.current <= 0)
+      return;
+
+    /* remember the current position so we can come back */
+    if(Zathura.Jumps.current == Zathura.Jumps.count)
+    {
+      add_jump();
+      if(Zathura.Jumps.count < 2)
+        return;
+      Zathura.Jumps.current--;
+    }
+
+    Zathura.Jumps.current--;
+  }
+  else
+  {
+    if(Zathura.Jumps.current + 1 >= Zathura.Jumps.count)
+      return;
+
+    Zathura.Jumps.current++;
+  }
+
+  Jump* jump = get_jump(Zathura.Jumps.current);
+
+  set_page(jump->page);
+  restore_page_position(&(jump->position));
+
+  update_status();
+}
+
 void
 sc_navigate(Argument* argument)
 {
@@ -2370,7 +5671,7 @@ sc_reload(Argument* argument)
   GtkAdjustment* hadjustment = gtk_scrolled_window_get_hadjustment(Zathura.UI.view);
 
   /* save old information */
-  g_static_mutex_lock(&(Zathura.Lock.pdf_obj_lock));
+  LOCK(pdf_obj_lock);
   char* path     = Zathura.PDF.file ? strdup(Zathura.PDF.file) : NULL;
   char* password = Zathura.PDF.password ? strdup(Zathura.PDF.password) : NULL;
   int scale      = Zathura.PDF.scale;
@@ -2384,7 +5685,7 @@ sc_reload(Argument* argument)
   close_file(TRUE);
   open_file(path, password);
 
-  g_static_mutex_lock(&(Zathura.Lock.pdf_obj_lock));
+  LOCK(pdf_obj_lock);
   Zathura.PDF.scale  = scale;
   Zathura.PDF.rotate = rotate;
   gtk_adjustment_set_value(vadjustment, va);
@@ -2499,7 +5800,7 @@ sc_scroll(Argument* argument)
 void
 sc_search(Argument* argument)
 {
-  g_static_mutex_lock(&(Zathura.Lock.search_lock));
+  LOCK(search_lock);
   if(Zathura.Thread.search_thread_running)
   {
     Zathura.Thread.search_thread_running = FALSE;
@@ -2507,7 +5808,7 @@ sc_search(Argument* argument)
     gdk_threads_leave();
     g_thread_join(Zathura.Thread.search_thread);
     gdk_threads_enter();
-    g_static_mutex_lock(&(Zathura.Lock.search_lock));
+    LOCK(search_lock);
   }
 
   Argument* newarg = g_malloc0(sizeof(Argument));
@@ -2540,6 +5841,34 @@ sc_switch_goto_mode(Argument* argument)
   update_status();
 }
 
+gboolean
+cb_index_build(gpointer data)
+{
+  GtkTreeModel* model = (GtkTreeModel*) data;
+
+  /* build for a few milliseconds per iteration to keep the interface
+   * responsive */
+  gint64 start = g_get_monotonic_time();
+  while(!g_queue_is_empty(Zathura.Index.pending) && g_get_monotonic_time() - start < 5000)
+  {
+    GtkTreeIter* iter = g_queue_pop_head(Zathura.Index.pending);
+
+    /* the store is only cleared together with the queue */
+    if(iter->stamp == GTK_TREE_STORE(model)->stamp)
+      expand_index(model, iter);
+
+    gtk_tree_iter_free(iter);
+  }
+
+  if(g_queue_is_empty(Zathura.Index.pending))
+  {
+    Zathura.Index.builder = 0;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 gboolean cb_index_row_activated(GtkTreeView* treeview, GtkTreePath* path,
   GtkTreeViewColumn* column, gpointer user_data)
 {
@@ -2551,7 +5880,6 @@ gboolean cb_index_row_activated(GtkTreeView* treeview, GtkTreePath* path,
   if(gtk_tree_model_get_iter(model, &iter, path))
   {
     PopplerAction* action;
-    PopplerDest*   destination;
 
     gtk_tree_model_get(model, &iter, 1, &action, -1);
     if(!action)
@@ -2559,19 +5887,9 @@ gboolean cb_index_row_activated(GtkTreeView* treeview, GtkTreePath* path,
 
     if(action->type == POPPLER_ACTION_GOTO_DEST)
     {
-      destination = action->goto_dest.dest;
-      int page_number = destination->page_num;
-
-      if(action->goto_dest.dest->type == POPPLER_DEST_NAMED)
-      {
-        PopplerDest* d = poppler_document_find_dest(Zathura.PDF.document, action->goto_dest.dest->named_dest);
-        if(d)
-        {
-          page_number = d->page_num;
-          poppler_dest_free(d);
-        }
-      }
+      int page_number = find_dest_page(action->goto_dest.dest);
 
+      add_jump();
       set_page(page_number - 1);
       update_status();
       Zathura.Global.show_index = FALSE;
@@ -2585,6 +5903,13 @@ gboolean cb_index_row_activated(GtkTreeView* treeview, GtkTreePath* path,
   return TRUE;
 }
 
+gboolean
+cb_index_row_expand(GtkTreeView* treeview, GtkTreeIter* iter, GtkTreePath* path, gpointer user_data)
+{
+  expand_index(gtk_tree_view_get_model(treeview), iter);
+  return FALSE;
+}
+
 void
 sc_navigate_index(Argument* argument)
 {
@@ -2648,6 +5973,8 @@ sc_navigate_index(Argument* argument)
       }
       break;
     case EXPAND:
+      gtk_tree_model_get_iter(model, &iter, path);
+      expand_index(model, &iter);
       if(gtk_tree_view_expand_row(treeview, path, FALSE))
         gtk_tree_path_down(path);
       break;
@@ -2681,11 +6008,14 @@ sc_toggle_index(Argument* argument)
 
     if((iter = poppler_index_iter_new(Zathura.PDF.document)))
     {
-      model = GTK_TREE_MODEL(gtk_tree_store_new(2, G_TYPE_STRING, G_TYPE_POINTER));
-      g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+      model = GTK_TREE_MODEL(gtk_tree_store_new(3, G_TYPE_STRING, G_TYPE_POINTER, G_TYPE_POINTER));
+      LOCK(pdflib_lock);
       build_index(model, NULL, iter);
       g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
       poppler_index_iter_free(iter);
+
+      /* build the remaining levels in the background */
+      Zathura.Index.builder = gdk_threads_add_idle_full(G_PRIORITY_LOW, cb_index_build, model, NULL);
     }
     else
     {
@@ -2705,6 +6035,7 @@ sc_toggle_index(Argument* argument)
 
     gtk_tree_view_set_cursor(GTK_TREE_VIEW(treeview), gtk_tree_path_new_first(), NULL, FALSE);
     g_signal_connect(G_OBJECT(treeview), "row-activated", G_CALLBACK(cb_index_row_activated), NULL);
+    g_signal_connect(G_OBJECT(treeview), "test-expand-row", G_CALLBACK(cb_index_row_expand), NULL);
 
     gtk_container_add (GTK_CONTAINER (Zathura.UI.index), treeview);
     gtk_widget_show (treeview);
@@ -2876,9 +6207,11 @@ isc_completion(Argument* argument)
   /* static elements */
   static GtkBox        *results = NULL;
   static CompletionRow *rows    = NULL;
+  static GtkEventBox  **widgets = NULL;
 
   static int current_item = 0;
   static int n_items      = 0;
+  static int n_widgets    = 0;
 
   static char *previous_command   = NULL;
   static char *previous_parameter = NULL;
@@ -2913,9 +6246,14 @@ isc_completion(Argument* argument)
       free(rows);
     }
 
+    if(widgets)
+      free(widgets);
+
     rows         = NULL;
+    widgets      = NULL;
     current_item = 0;
     n_items      = 0;
+    n_widgets    = 0;
     command_mode = TRUE;
 
     if(argument->n == HIDE)
@@ -3005,8 +6343,9 @@ isc_completion(Argument* argument)
       command_mode               = FALSE;
       CompletionGroup* group     = NULL;
       CompletionElement* element = NULL;
+      int rows_size              = 64;
 
-      rows = malloc(sizeof(CompletionRow));
+      rows = malloc(rows_size * sizeof(CompletionRow));
       if(!rows)
         out_of_memory();
 
@@ -3018,22 +6357,27 @@ isc_completion(Argument* argument)
         {
           if(element->value)
           {
+            /* room for the group header and the element */
+            if(n_items + 2 > rows_size)
+            {
+              rows_size *= 2;
+              rows = realloc(rows, rows_size * sizeof(CompletionRow));
+              if(!rows)
+                out_of_memory();
+            }
+
             if(group->value && !group_elements)
             {
-              rows = realloc(rows, (n_items + 1) * sizeof(CompletionRow));
               rows[n_items].command     = g_strdup(group->value);
               rows[n_items].description = NULL;
               rows[n_items].command_id  = -1;
-              rows[n_items].is_group    = TRUE;
-              rows[n_items++].row       = GTK_WIDGET(create_completion_row(results, group->value, NULL, TRUE));
+              rows[n_items++].is_group  = TRUE;
             }
 
-            rows = realloc(rows, (n_items + 1) * sizeof(CompletionRow));
             rows[n_items].command     = g_strdup(element->value);
             rows[n_items].description = element->description ? g_strdup(element->description) : NULL;
             rows[n_items].command_id  = previous_id;
-            rows[n_items].is_group    = FALSE;
-            rows[n_items++].row       = GTK_WIDGET(create_completion_row(results, element->value, element->description, FALSE));
+            rows[n_items++].is_group  = FALSE;
             group_elements++;
           }
         }
@@ -3068,14 +6412,23 @@ isc_completion(Argument* argument)
           rows[n_items].command     = g_strdup(commands[i].command);
           rows[n_items].description = g_strdup(commands[i].description);
           rows[n_items].command_id  = i;
-          rows[n_items].is_group    = FALSE;
-          rows[n_items++].row       = GTK_WIDGET(create_completion_row(results, commands[i].command, commands[i].description, FALSE));
+          rows[n_items++].is_group  = FALSE;
         }
       }
 
       rows = realloc(rows, n_items * sizeof(CompletionRow));
     }
 
+    /* only the visible rows are backed by widgets; they are refilled as
+     * the selection moves */
+    n_widgets = MIN(n_items, MAX(n_completion_items, 1));
+    widgets   = malloc(sizeof(GtkEventBox*) * MAX(n_widgets, 1));
+    if(!widgets)
+      out_of_memory();
+
+    for(int i = 0; i < n_widgets; i++)
+      widgets[i] = create_completion_row(results, NULL, NULL, FALSE);
+
     gtk_box_pack_start(Zathura.UI.box, GTK_WIDGET(results), FALSE, FALSE, 0);
     gtk_widget_show_all(GTK_WIDGET(Zathura.UI.window));
 
@@ -3087,7 +6440,6 @@ isc_completion(Argument* argument)
    */
   if( (results) && (n_items > 0) )
   {
-    set_completion_row_color(results, NORMAL, current_item);
     char* temp;
     int i = 0, next_group = 0;
 
@@ -3112,22 +6464,27 @@ isc_completion(Argument* argument)
       }
     }
 
-    set_completion_row_color(results, HIGHLIGHT, current_item);
+    /* fill the visible window around the current item */
+    int uh    = ceil(n_completion_items / 2);
+    int lh    = floor(n_completion_items / 2);
+    int first = 0;
 
-    /* hide other items */
-    int uh = ceil(n_completion_items / 2);
-    int lh = floor(n_completion_items / 2);
+    if(current_item >= lh)
+      first = (current_item >= (n_items - uh)) ? (n_items - n_widgets) : (current_item - lh);
+    first = MAX(0, MIN(first, n_items - n_widgets));
 
-    for(i = 0; i < n_items; i++)
+    for(i = 0; i < n_widgets; i++)
     {
-     if((n_items > 1) && (
-        (i >= (current_item - lh) && (i <= current_item + uh)) ||
-        (i < n_completion_items && current_item < lh) ||
-        (i >= (n_items - n_completion_items) && (current_item >= (n_items - uh))))
-       )
-        gtk_widget_show(rows[i].row);
+      CompletionRow* row = &(rows[first + i]);
+
+      if(n_items > 1)
+      {
+        update_completion_row(widgets[i], row->command, row->description, row->is_group,
+            (first + i == current_item) ? HIGHLIGHT : NORMAL);
+        gtk_widget_show(GTK_WIDGET(widgets[i]));
+      }
       else
-        gtk_widget_hide(rows[i].row);
+        gtk_widget_hide(GTK_WIDGET(widgets[i]));
     }
 
     if(command_mode)
@@ -3231,35 +6588,21 @@ cmd_bookmark(int argc, char** argv)
     return FALSE;
   }
 
-  /* reload the bookmark file */
+  /* pick up changes of other instances */
   read_bookmarks_file();
 
-  /* check for existing bookmark to overwrite */
-  int next = Zathura.Bookmarks.number_of_bookmarks;
-  for(i = 0; i < next; i++)
-  {
-    if(!strcmp(id->str, Zathura.Bookmarks.bookmarks[i].id))
-    {
-      Zathura.Bookmarks.bookmarks[i].page = Zathura.PDF.page_number;
-      Zathura.Bookmarks.bookmarks[i].scale = Zathura.PDF.scale;
-      save_page_position(&Zathura.Bookmarks.bookmarks[i].position, 0);
-      g_string_free(id, TRUE);
-      return TRUE;
-    }
-  }
-
-  /* add new bookmark */
-  Zathura.Bookmarks.bookmarks = realloc(Zathura.Bookmarks.bookmarks,
-      (next + 1) * sizeof(Bookmark));
+  /* add or overwrite the bookmark */
+  PagePosition position;
+  save_page_position(&position, 0);
 
-  Zathura.Bookmarks.bookmarks[next].id    = g_strdup(id->str);
-  Zathura.Bookmarks.bookmarks[next].page  = Zathura.PDF.page_number;
-  Zathura.Bookmarks.bookmarks[next].scale = Zathura.PDF.scale;
-  save_page_position(&Zathura.Bookmarks.bookmarks[next].position, 0);
-  Zathura.Bookmarks.number_of_bookmarks++;
+  gchar* path = g_strescape(Zathura.PDF.file, NULL);
+  gchar* name = g_strescape(id->str, NULL);
+  store_bookmark_record(g_strdup_printf("B\t%s\t%s\t%d\t%d\t%d\t%d\n", path, name,
+        Zathura.PDF.page_number, Zathura.PDF.scale, (int) position.x, (int) position.y), NULL);
+  g_free(name);
+  g_free(path);
 
-  /* write the bookmark file */
-  write_bookmarks_file();
+  load_bookmarks(Zathura.PDF.file);
 
   g_string_free(id, TRUE);
   return TRUE;
@@ -3289,15 +6632,15 @@ cmd_open_bookmark(int argc, char** argv)
   {
     if(!strcmp(id->str, bmarks[i].id))
     {
-      set_page(bmarks[i].page);
+      /* set the scale first so that the page is only drawn once */
       if(Zathura.PDF.scale != bmarks[i].scale)
       {
         Zathura.Global.adjust_mode = ADJUST_NONE;
         Zathura.PDF.scale = bmarks[i].scale;
-        Zathura.Search.draw = TRUE;
-        draw(Zathura.PDF.page_number);
-        update_status();
       }
+      add_jump();
+      set_page(bmarks[i].page);
+      update_status();
       restore_page_position(&bmarks[i].position);
       g_string_free(id, TRUE);
       return TRUE;
@@ -3353,31 +6696,23 @@ cmd_delete_bookmark(int argc, char** argv)
     id = g_string_append(id, argv[i]);
   }
 
-  /* reload bookmark file */
+  /* pick up changes of other instances */
   read_bookmarks_file();
+  load_bookmarks(Zathura.PDF.file);
 
   /* check for bookmark to delete */
   for(i = 0; i < Zathura.Bookmarks.number_of_bookmarks; i++)
   {
     if(!strcmp(id->str, Zathura.Bookmarks.bookmarks[i].id))
     {
-      /* update key file */
-      g_key_file_remove_key(Zathura.Bookmarks.data, Zathura.PDF.file, Zathura.Bookmarks.bookmarks[i].id, NULL);
-
-      g_free(Zathura.Bookmarks.bookmarks[i].id);
-      /* update bookmarks */
-      Zathura.Bookmarks.bookmarks[i].id   = Zathura.Bookmarks.bookmarks[Zathura.Bookmarks.number_of_bookmarks - 1].id;
-      Zathura.Bookmarks.bookmarks[i].page = Zathura.Bookmarks.bookmarks[Zathura.Bookmarks.number_of_bookmarks - 1].page;
-      Zathura.Bookmarks.bookmarks = realloc(Zathura.Bookmarks.bookmarks,
-          Zathura.Bookmarks.number_of_bookmarks * sizeof(Bookmark));
-
-      Zathura.Bookmarks.number_of_bookmarks--;
-      g_string_free(id, TRUE);
-
-      /* write bookmark file */
-      write_bookmarks_file();
+      gchar* path = g_strescape(Zathura.PDF.file, NULL);
+      gchar* name = g_strescape(id->str, NULL);
+      store_bookmark_record(g_strdup_printf("D\t%s\t%s\n", path, name), NULL);
+      g_free(name);
+      g_free(path);
 
-      return TRUE;
+      load_bookmarks(Zathura.PDF.file);
+      break;
     }
   }
 
@@ -3400,61 +6735,90 @@ cmd_export(int argc, char** argv)
   /* export images */
   if(!strcmp(argv[0], "images"))
   {
-    int page_number;
-    for(page_number = 0; page_number < Zathura.PDF.number_of_pages; page_number++)
-    {
-      GList           *image_list;
-      GList           *images;
-      cairo_surface_t *image;
-
-      g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-      image_list = poppler_page_get_image_mapping(Zathura.PDF.pages[page_number]->page);
-      g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+    ExportJob* job = create_export_job(argv[1], 0, Zathura.PDF.number_of_pages - 1);
 
-      if(!g_list_length(image_list))
-      {
-        notify(WARNING, "This document does not contain any images");
-        return FALSE;
-      }
+    job->description = "Exporting images";
+    job->unit        = "images";
+    job->empty       = "This document does not contain any images";
+    job->export_page = export_page_images;
 
-      for(images = image_list; images; images = g_list_next(images))
-      {
-        PopplerImageMapping *image_mapping;
-        gint                 image_id;
-        char*                file;
-        char*                filename;
+    start_export_job(job, get_number_of_export_workers());
+  }
+  /* export pages: <range> <dir> [scale] [png|ppm] */
+  else if(!strcmp(argv[0], "pages"))
+  {
+    int first_page, last_page;
+    if(!parse_page_range(argv[1], &first_page, &last_page))
+    {
+      notify(WARNING, "Invalid page range");
+      return FALSE;
+    }
 
-        image_mapping = (PopplerImageMapping*) images->data;
-        image_id      = image_mapping->image_id;
+    if(argc < 3)
+    {
+      notify(WARNING, "No export path specified");
+      return FALSE;
+    }
 
-        g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-        image     = poppler_page_get_image(Zathura.PDF.pages[page_number]->page, image_id);
-        g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+    int scale = (argc >= 4) ? atoi(argv[3]) : Zathura.PDF.scale;
+    if(scale <= 0)
+    {
+      notify(WARNING, "Invalid scale");
+      return FALSE;
+    }
+    else if(scale > zoom_max)
+      scale = zoom_max;
 
-        if(!image)
-          continue;
+    ExportJob* job = create_export_job(argv[2], first_page, last_page);
 
-        filename  = g_strdup_printf("%s_p%i_i%i.png", Zathura.PDF.file, page_number + 1, image_id);
+    job->description = "Exporting pages";
+    job->unit        = "pages";
+    job->empty       = "No pages exported";
+    job->export_page = export_page_raster;
+    job->scale       = scale;
+    job->rotate      = Zathura.PDF.rotate;
+    job->recolor     = Zathura.Global.recolor;
+    job->ppm         = (argc >= 5 && !strcmp(argv[4], "ppm"));
 
-        if(argv[1][0] == '~')
-        {
-          gchar* home_path = get_home_dir();
-          file = g_strdup_printf("%s%s%s", home_path, argv[1] + 1, filename);
-          g_free(home_path);
-        }
-        else
-          file = g_strdup_printf("%s%s", argv[1], filename);
+    start_export_job(job, 0);
+  }
+  /* export text: <file> [range] */
+  else if(!strcmp(argv[0], "text"))
+  {
+    int first_page = 0;
+    int last_page  = Zathura.PDF.number_of_pages - 1;
+    if(argc >= 3 && !parse_page_range(argv[2], &first_page, &last_page))
+    {
+      notify(WARNING, "Invalid page range");
+      return FALSE;
+    }
 
-        cairo_surface_write_to_png(image, file);
+    ExportJob* job = create_export_job(argv[1], first_page, last_page);
 
-        g_free(filename);
-        g_free(file);
-      }
+    job->output = fopen(job->path, "w");
+    if(!job->output)
+    {
+      notify(ERROR, "Could not open the export file");
+      free_export_job(job);
+      return FALSE;
     }
+
+    job->description = "Exporting text";
+    job->unit        = "pages";
+    job->empty       = "No text exported";
+    job->export_page = export_page_text;
+    job->mutex       = g_mutex_new();
+    job->cond        = g_cond_new();
+    job->next_write  = first_page;
+    job->texts       = calloc(EXPORT_QUEUE_SIZE, sizeof(gchar*));
+    if(!job->texts)
+      out_of_memory();
+
+    start_export_job(job, 0);
   }
   else if(!strcmp(argv[0], "attachments"))
   {
-    g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+    LOCK(pdflib_lock);
     if(!poppler_document_has_attachments(Zathura.PDF.document))
     {
       notify(WARNING, "PDF file has no attachments");
@@ -3481,7 +6845,7 @@ cmd_export(int argc, char** argv)
       else
         file = g_strdup_printf("%s%s", argv[1], attachment->name);
 
-      g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+      LOCK(pdflib_lock);
       poppler_attachment_save(attachment, file, NULL);
       g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
@@ -3492,6 +6856,95 @@ cmd_export(int argc, char** argv)
   return TRUE;
 }
 
+gboolean
+cmd_grep(int argc, char** argv)
+{
+  if(argc == 0)
+    return TRUE;
+
+  /* assembly the arguments back to one string */
+  int i;
+  GString *parameter = g_string_new("");
+  for(i = 0; i < argc; i++)
+  {
+    if(i != 0)
+      parameter = g_string_append_c(parameter, ' ');
+
+    parameter = g_string_append(parameter, argv[i]);
+  }
+
+  /* open a hit that has been chosen in the completion */
+  GList* list;
+  for(list = Zathura.Grep.hits; list; list = g_list_next(list))
+  {
+    GrepHit* hit = (GrepHit*) list->data;
+    char*    id  = g_strdup_printf("%s:%i", hit->file, hit->page + 1);
+    gboolean found = !strcmp(id, parameter->str);
+    g_free(id);
+
+    if(found)
+    {
+      g_string_free(parameter, TRUE);
+
+      if(!Zathura.PDF.file || strcmp(Zathura.PDF.file, hit->file))
+      {
+        if(!open_file(hit->file, NULL))
+          return FALSE;
+      }
+
+      add_jump();
+      set_page(hit->page);
+      update_status();
+      return TRUE;
+    }
+  }
+
+  g_string_free(parameter, TRUE);
+
+  if(argc < 2)
+  {
+    notify(WARNING, "No search directory specified");
+    return FALSE;
+  }
+
+  /* stop a running search */
+  LOCK(search_lock);
+  if(Zathura.Thread.grep_thread)
+  {
+    Zathura.Thread.grep_thread_running = FALSE;
+    g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+    gdk_threads_leave();
+    g_thread_join(Zathura.Thread.grep_thread);
+    gdk_threads_enter();
+    LOCK(search_lock);
+    Zathura.Thread.grep_thread = NULL;
+  }
+
+  GString *directory = g_string_new("");
+  for(i = 1; i < argc; i++)
+  {
+    if(i != 1)
+      directory = g_string_append_c(directory, ' ');
+
+    directory = g_string_append(directory, argv[i]);
+  }
+
+  GrepJob* job   = g_malloc0(sizeof(GrepJob));
+  job->pattern   = g_ascii_strdown(argv[0], -1);
+  job->directory = fix_path(directory->str);
+  job->hits      = NULL;
+  job->lock      = g_mutex_new();
+  job->message   = "Searching...";
+  g_string_free(directory, TRUE);
+
+  Zathura.Thread.grep_thread_running = TRUE;
+  Zathura.Thread.grep_thread = g_thread_create(grep, (gpointer) job, TRUE, NULL);
+  g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+  notify(DEFAULT, job->message);
+  return FALSE;
+}
+
 gboolean
 cmd_info(int argc, char** argv)
 {
@@ -3732,6 +7185,8 @@ cmd_map(int argc, char** argv)
   if(sc)
     sc->next = entry;
 
+  build_shortcut_table();
+
   return TRUE;
 }
 
@@ -3784,7 +7239,7 @@ cmd_print(int argc, char** argv)
 
   char* escaped_filename = g_shell_quote(Zathura.PDF.file);
   char* command          = g_strdup_printf(print_command, printer, sites, addit->str, escaped_filename);
-  system(command);
+  spawn_command(command, "Printing", TRUE);
 
   g_free(sites);
   g_free(escaped_filename);
@@ -3890,6 +7345,14 @@ cmd_set(int argc, char** argv)
       if(settings[i].reinit)
         init_look();
 
+      /* recolored pages in the cache still use the old colors */
+      if(settings[i].variable == &recolor_darkcolor || settings[i].variable == &recolor_lightcolor)
+      {
+        render_cache_clear();
+        if(Zathura.PDF.document && Zathura.Global.recolor)
+          draw(Zathura.PDF.page_number);
+      }
+
       /* render */
       if(settings[i].render)
       {
@@ -3938,33 +7401,42 @@ save_file(int argc, char** argv, gboolean overwrite)
     return FALSE;
   }
 
-  char* path = NULL;
-  if (file_path[0] == '/')
-    path = g_strdup_printf("file://%s", file_path);
-  else
+  if(!g_path_is_absolute(file_path))
   {
     char* cur = g_get_current_dir();
-    path = g_strdup_printf("file://%s/%s", cur, file_path);
+    gchar* absolute_path = g_build_filename(cur, file_path, NULL);
     g_free(cur);
+    g_free(file_path);
+    file_path = absolute_path;
   }
-  g_free(file_path);
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-  /* format path */
-  GError* error = NULL;
-  if (!poppler_document_save(Zathura.PDF.document, path, &error))
+  /* save in the background */
+  SaveJob* job = malloc(sizeof(SaveJob));
+  if(!job)
+    out_of_memory();
+
+  job->source   = g_strdup(Zathura.PDF.file);
+  job->target   = file_path;
+  job->tmp      = g_strdup_printf("%s.XXXXXX", file_path);
+  job->document = g_object_ref(Zathura.PDF.document);
+  job->progress = 0;
+  job->cancel   = 0;
+  job->success  = FALSE;
+  job->error    = NULL;
+
+  Zathura.Export.saves = g_list_append(Zathura.Export.saves, job);
+  if(!Zathura.Export.progress)
+    Zathura.Export.progress = gdk_threads_add_timeout(250, cb_export_progress, NULL);
+
+  job->thread = g_thread_create(save_document, job, TRUE, NULL);
+  if(!job->thread)
   {
-    g_free(path);
-    char* message = g_strdup_printf("Can not write file: %s", error->message);
-    notify(ERROR, message);
-    g_free(message);
-    g_error_free(error);
-    g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+    job->error = g_strdup("Could not start saving");
+    cb_save_finished(job);
     return FALSE;
   }
 
-  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
-  g_free(path);
+  update_status_text();
 
   return TRUE;
 }
@@ -4015,6 +7487,40 @@ cc_export(char* input)
 
   completion_group_add_element(group, "images",      "Export images");
   completion_group_add_element(group, "attachments", "Export attachments");
+  completion_group_add_element(group, "pages",       "Export pages as images");
+  completion_group_add_element(group, "text",        "Export the text of the document");
+
+  return completion;
+}
+
+Completion*
+cc_grep(char* input)
+{
+  Completion* completion = completion_init();
+  CompletionGroup* group = NULL;
+
+  int input_length = input ? strlen(input) : 0;
+
+  GList* list;
+  for(list = Zathura.Grep.hits; list; list = g_list_next(list))
+  {
+    GrepHit* hit = (GrepHit*) list->data;
+    char*    id  = g_strdup_printf("%s:%i", hit->file, hit->page + 1);
+
+    if( (input_length <= strlen(id)) && !strncmp(input, id, input_length) )
+    {
+      /* one group per document */
+      if(!group || strcmp(group->value, hit->file))
+      {
+        group = completion_group_create(hit->file);
+        completion_add_group(completion, group);
+      }
+
+      completion_group_add_element(group, id, hit->context);
+    }
+
+    g_free(id);
+  }
 
   return completion;
 }
@@ -4088,10 +7594,14 @@ cc_open(char* input)
 
   file_length = strlen(file);
 
-  /* open directory */
-  GDir* dir = g_dir_open(path, 0, NULL);
-  if(!dir)
+  /* the directory is read in the background; the completion is shown
+   * again once the listing is available */
+  DirectoryListing* listing = get_directory_listing(path);
+  if(listing->loading || !listing->entries)
   {
+    if(listing->loading)
+      wait_for_completion();
+
     g_free(path);
     g_free(file);
     completion_free(completion);
@@ -4099,30 +7609,19 @@ cc_open(char* input)
   }
 
   /* create element list */
-  char* name = NULL;
-
-  while((name = (char*) g_dir_read_name(dir)) != NULL)
+  int i;
+  for(i = 0; i < listing->entries->len; i++)
   {
-    char* d_name   = g_filename_display_name(name);
-    int   d_length = strlen(d_name);
+    char* d_name = g_ptr_array_index(listing->entries, i);
 
-    if( ((file_length <= d_length) && !strncmp(file, d_name, file_length)) ||
-        (file_length == 0) )
+    if(file_length == 0 || !strncmp(file, d_name, file_length))
     {
       char* d = g_strdup_printf("%s%s", path, d_name);
-      if(g_file_test(d, G_FILE_TEST_IS_DIR))
-      {
-        gchar *subdir = d;
-        d = g_strdup_printf("%s/", subdir);
-        g_free(subdir);
-      }
       completion_group_add_element(group, d, NULL);
       g_free(d);
     }
-    g_free(d_name);
   }
 
-  g_dir_close(dir);
   g_free(file);
   g_free(path);
 
@@ -4139,49 +7638,26 @@ cc_print(char* input)
 
   int input_length = input ? strlen(input) : 0;
 
-  /* read printers */
-  char *current_line = NULL, current_char;
-  int count = 0;
-  FILE *fp;
+  /* the printers are listed in the background; a stale list is used
+   * while it is refreshed */
+  update_printers();
 
-  fp = popen(list_printer_command, "r");
-
-  if(!fp)
+  if(!Zathura.Printers.list)
   {
+    wait_for_completion();
     completion_free(completion);
     return NULL;
   }
 
-  while((current_char = fgetc(fp)) != EOF)
+  int i;
+  for(i = 0; Zathura.Printers.list[i]; i++)
   {
-    if(!current_line)
-      current_line = malloc(sizeof(char));
-    if(!current_line)
-      out_of_memory();
-
-    current_line = realloc(current_line, (count + 1) * sizeof(char));
-
-    if(current_char != '\n')
-      current_line[count++] = current_char;
-    else
-    {
-      current_line[count] = '\0';
-      int line_length = strlen(current_line);
+    char* printer = Zathura.Printers.list[i];
 
-      if( (input_length <= line_length) ||
-          (!strncmp(input, current_line, input_length)) )
-      {
-        completion_group_add_element(group, current_line, NULL);
-      }
-
-      free(current_line);
-      current_line = NULL;
-      count = 0;
-    }
+    if(strlen(printer) > 0 && !strncmp(input ? input : "", printer, input_length))
+      completion_group_add_element(group, printer, NULL);
   }
 
-  pclose(fp);
-
   return completion;
 }
 
@@ -4219,6 +7695,8 @@ bcmd_goto(char* buffer, Argument* argument)
   if(b_length < 1)
     return;
 
+  add_jump();
+
   if(!strcmp(buffer, "gg"))
     set_page(0);
   else if(!strcmp(buffer, "G"))
@@ -4257,6 +7735,7 @@ try_goto(const char* buffer)
     {
       /* behave like vim: <= 1 => first line, >= #lines => last line */
       page_number = MAX(0, MIN(Zathura.PDF.number_of_pages - 1, page_number));
+      add_jump();
       set_page(page_number);
       update_status();
       return TRUE;
@@ -4344,19 +7823,75 @@ cb_destroy(GtkWidget* widget, gpointer data)
 {
   pango_font_description_free(Zathura.Style.font);
 
+  /* stop running searches */
+  LOCK(search_lock);
+  gboolean searching = Zathura.Thread.search_thread_running;
+  Zathura.Thread.search_thread_running = FALSE;
+  Zathura.Thread.grep_thread_running   = FALSE;
+  g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+  gdk_threads_leave();
+  if(searching)
+    g_thread_join(Zathura.Thread.search_thread);
+  if(Zathura.Thread.grep_thread)
+    g_thread_join(Zathura.Thread.grep_thread);
+  gdk_threads_enter();
+  Zathura.Thread.grep_thread = NULL;
+
+  /* stop running exports, their results are not reported anymore */
+  GList* list;
+  for(list = Zathura.Export.jobs; list; list = g_list_next(list))
+  {
+    ExportJob* job = (ExportJob*) list->data;
+    cancel_export_job(job);
+
+    int i;
+    for(i = 0; i < job->number_of_threads; i++)
+    {
+      if(job->threads[i])
+        g_thread_join(job->threads[i]);
+      job->threads[i] = NULL;
+    }
+  }
+
+  /* documents that are being saved are finished first */
+  for(list = Zathura.Export.saves; list; list = g_list_next(list))
+  {
+    SaveJob* job = (SaveJob*) list->data;
+    if(job->thread)
+      g_thread_join(job->thread);
+    job->thread = NULL;
+  }
+
   if(Zathura.PDF.document)
     close_file(FALSE);
 
-  /* clean up bookmarks */
+  /* write the remaining records and clean up bookmarks */
+  if(Zathura.Bookmarks.autosave)
+    g_source_remove(Zathura.Bookmarks.autosave);
+
+  LOCK(bookmarks_lock);
+  Zathura.Bookmarks.stop = TRUE;
+  g_cond_signal(Zathura.Bookmarks.cond);
+  g_static_mutex_unlock(&(Zathura.Lock.bookmarks_lock));
+
+  if(Zathura.Thread.bookmarks_thread)
+    g_thread_join(Zathura.Thread.bookmarks_thread);
+  if(Zathura.Bookmarks.fd != -1)
+    close(Zathura.Bookmarks.fd);
+  g_hash_table_destroy(Zathura.Bookmarks.documents);
+  g_hash_table_destroy(Zathura.Bookmarks.queued_positions);
+  g_queue_free(Zathura.Bookmarks.queue);
+  g_cond_free(Zathura.Bookmarks.cond);
   g_free(Zathura.Bookmarks.file);
-  if (Zathura.Bookmarks.data)
-    g_key_file_free(Zathura.Bookmarks.data);
 
   /* destroy mutexes */
   g_static_mutex_free(&(Zathura.Lock.pdflib_lock));
   g_static_mutex_free(&(Zathura.Lock.search_lock));
   g_static_mutex_free(&(Zathura.Lock.pdf_obj_lock));
   g_static_mutex_free(&(Zathura.Lock.select_lock));
+  g_static_mutex_free(&(Zathura.Lock.render_lock));
+  g_static_mutex_free(&(Zathura.Lock.bookmarks_lock));
 
   /* inotify */
   if(Zathura.FileMonitor.monitor)
@@ -4367,6 +7902,9 @@ cb_destroy(GtkWidget* widget, gpointer data)
   g_list_free(Zathura.Global.history);
 
   /* clean shortcut list */
+  if(Zathura.Bindings.sctable)
+    g_hash_table_destroy(Zathura.Bindings.sctable);
+
   ShortcutList* sc = Zathura.Bindings.sclist;
 
   while(sc)
@@ -4379,12 +7917,23 @@ cb_destroy(GtkWidget* widget, gpointer data)
   g_free(Zathura.State.filename);
   g_free(Zathura.State.pages);
 
+  free_grep_hits(Zathura.Grep.hits);
+  g_queue_free(Zathura.Index.pending);
+  render_cache_clear();
+  g_queue_free(Zathura.Render.cache);
+  g_hash_table_destroy(Zathura.Directories.listings);
+  g_free(Zathura.Global.pending_completion);
+  g_strfreev(Zathura.Printers.list);
+
   g_free(Zathura.Config.config_dir);
   g_free(Zathura.Config.data_dir);
   if (Zathura.StdinSupport.file)
     g_unlink(Zathura.StdinSupport.file);
   g_free(Zathura.StdinSupport.file);
 
+  close_trace();
+  g_static_mutex_free(&(Zathura.Lock.trace_lock));
+
   gtk_main_quit();
 
   return TRUE;
@@ -4399,15 +7948,15 @@ gboolean cb_draw(GtkWidget* widget, GdkEventExpose* expose, gpointer data)
   if(page_id < 0 || page_id > Zathura.PDF.number_of_pages)
     return FALSE;
 
+  gint64 trace = TRACE_BEGIN();
+
   gdk_window_clear(widget->window);
   cairo_t *cairo = gdk_cairo_create(widget->window);
 
   double page_width, page_height, width, height;
   double scale = ((double) Zathura.PDF.scale / 100.0);
 
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-  poppler_page_get_size(Zathura.PDF.pages[page_id]->page, &page_width, &page_height);
-  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+  get_page_size(page_id, &page_width, &page_height);
 
   if(Zathura.PDF.rotate == 0 || Zathura.PDF.rotate == 180)
   {
@@ -4445,11 +7994,213 @@ gboolean cb_draw(GtkWidget* widget, GdkEventExpose* expose, gpointer data)
 
   cairo_set_source_surface(cairo, Zathura.PDF.surface, offset_x, offset_y);
   cairo_paint(cairo);
+
+  /* selection overlay */
+  PageText* text = Zathura.Selection.active ? Zathura.PDF.pages[page_id]->text : NULL;
+  if(text && Zathura.Selection.page == page_id)
+  {
+    int first = MIN(Zathura.Selection.first, Zathura.Selection.last);
+    int last  = MAX(Zathura.Selection.first, Zathura.Selection.last);
+
+    int i;
+    for(i = first; i <= last; i++)
+    {
+      PopplerRectangle* device = &(text->device[i]);
+      cairo_rectangle(cairo, device->x1 + offset_x, device->y1 + offset_y,
+          (device->x2 - device->x1), (device->y2 - device->y1));
+    }
+
+    cairo_set_source_rgba(cairo, Zathura.Style.select_text.red / 65535.0, Zathura.Style.select_text.green / 65535.0,
+        Zathura.Style.select_text.blue / 65535.0, transparency);
+    cairo_fill(cairo);
+  }
+
   cairo_destroy(cairo);
 
+  TRACE_END("ui", "expose", trace);
+
   return TRUE;
 }
 
+void
+cb_child_exited(GPid pid, gint status, gpointer data)
+{
+  ChildProcess* child = (ChildProcess*) data;
+  gchar* message      = NULL;
+  int    level        = DEFAULT;
+
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+  {
+    message = g_strdup_printf("%s failed (exit status %i)",
+        child->description, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    level   = ERROR;
+  }
+  else if(child->report_success)
+    message = g_strdup_printf("%s finished", child->description);
+
+  if(message)
+  {
+    gdk_threads_enter();
+    notify(level, message);
+    gdk_threads_leave();
+    g_free(message);
+  }
+
+  g_spawn_close_pid(pid);
+  g_free(child->description);
+  free(child);
+}
+
+gboolean
+cb_directory_read(gpointer data)
+{
+  DirectoryListing* result  = (DirectoryListing*) data;
+  DirectoryListing* listing = g_hash_table_lookup(Zathura.Directories.listings, result->path);
+
+  /* the listing might have been invalidated and read again in the meantime */
+  if(!listing || !listing->loading || listing->generation != result->generation)
+  {
+    free_directory_listing(result);
+    return FALSE;
+  }
+
+  listing->entries = result->entries;
+  listing->loading = FALSE;
+  result->entries  = NULL;
+  free_directory_listing(result);
+
+  refresh_completion();
+
+  return FALSE;
+}
+
+gboolean
+cb_export_finished(gpointer data)
+{
+  ExportJob* job = (ExportJob*) data;
+
+  int i;
+  for(i = 0; i < job->number_of_threads; i++)
+    if(job->threads[i])
+      g_thread_join(job->threads[i]);
+
+  Zathura.Export.jobs = g_list_remove(Zathura.Export.jobs, job);
+  update_status_text();
+
+  if(job->output && fclose(job->output) != 0)
+    job->errors++;
+
+  /* report the result */
+  gchar* message;
+  int    level = DEFAULT;
+
+  if(g_atomic_int_get(&(job->cancel)) && !job->errors)
+  {
+    message = g_strdup_printf("Export cancelled after %i %s", job->written, job->unit);
+    level   = WARNING;
+  }
+  else if(job->errors)
+  {
+    message = g_strdup_printf("Exported %i %s, %i failed", job->written, job->unit, job->errors);
+    level   = ERROR;
+  }
+  else if(job->written == 0)
+  {
+    message = g_strdup(job->empty);
+    level   = WARNING;
+  }
+  else
+    message = g_strdup_printf("Exported %i %s", job->written, job->unit);
+
+  notify(level, message);
+  g_free(message);
+
+  free_export_job(job);
+
+  return FALSE;
+}
+
+gboolean
+cb_export_progress(gpointer data)
+{
+  update_status_text();
+
+  if(Zathura.Export.jobs || Zathura.Export.saves)
+    return TRUE;
+
+  Zathura.Export.progress = 0;
+  return FALSE;
+}
+
+gboolean
+cb_save_finished(gpointer data)
+{
+  SaveJob* job = (SaveJob*) data;
+
+  if(job->thread)
+    g_thread_join(job->thread);
+
+  Zathura.Export.saves = g_list_remove(Zathura.Export.saves, job);
+  update_status_text();
+
+  gchar* message;
+  if(job->success)
+    message = g_strdup_printf("Saved %s", job->target);
+  else
+    message = g_strdup_printf("Can not write file: %s", job->error ? job->error : "unknown error");
+
+  notify(job->success ? DEFAULT : ERROR, message);
+  g_free(message);
+
+  g_object_unref(job->document);
+  g_free(job->source);
+  g_free(job->target);
+  g_free(job->tmp);
+  g_free(job->error);
+  free(job);
+
+  return FALSE;
+}
+
+gboolean
+cb_printers_read(gpointer data)
+{
+  g_strfreev(Zathura.Printers.list);
+
+  Zathura.Printers.list    = (gchar**) data;
+  Zathura.Printers.updated = g_get_monotonic_time();
+  Zathura.Printers.loading = FALSE;
+
+  refresh_completion();
+
+  return FALSE;
+}
+
+void
+cb_directory_changed(GFileMonitor* monitor, GFile* file, GFile* other_file, GFileMonitorEvent event, gpointer data)
+{
+  DirectoryListing* listing = (DirectoryListing*) data;
+
+  /* only the names in the directory matter, writes to its files do not */
+  switch(event)
+  {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_DELETED:
+#if GLIB_CHECK_VERSION(2,24,0)
+    case G_FILE_MONITOR_EVENT_MOVED:
+#endif
+#if GLIB_CHECK_VERSION(2,46,0)
+    case G_FILE_MONITOR_EVENT_RENAMED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+#endif
+      g_hash_table_remove(Zathura.Directories.listings, listing->path);
+      break;
+    default:
+      break;
+  }
+}
+
 gboolean
 cb_inputbar_kb_pressed(GtkWidget *widget, GdkEventKey *event, gpointer data)
 {
@@ -4602,15 +8353,9 @@ cb_inputbar_form_activate(GtkEntry* entry, gpointer data)
   if(!Zathura.PDF.document)
     return TRUE;
 
-  Page* current_page = Zathura.PDF.pages[Zathura.PDF.page_number];
-  int number_of_links = 0, link_id = 1, new_page_id = Zathura.PDF.page_number;
-
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
-  GList *link_list = poppler_page_get_link_mapping(current_page->page);
-  g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
-  link_list = g_list_reverse(link_list);
+  PageLinks* links = get_page_links(Zathura.PDF.page_number);
 
-  if((number_of_links = g_list_length(link_list)) <= 0)
+  if(links->number_of_links <= 0)
     return FALSE;
 
   /* parse entry */
@@ -4620,54 +8365,19 @@ cb_inputbar_form_activate(GtkEntry* entry, gpointer data)
     return FALSE;
 
   int li = atoi(token);
-  if(li <= 0 || li > number_of_links)
-  {
-    set_page(Zathura.PDF.page_number);
-    isc_abort(NULL);
-    notify(WARNING, "Invalid hint");
-    return TRUE;
-  }
-
-  /* compare entry */
-  GList *links;
-  for(links = link_list; links; links = g_list_next(links))
-  {
-    PopplerLinkMapping *link_mapping = (PopplerLinkMapping*) links->data;
-    PopplerAction            *action = link_mapping->action;
-
-    /* only handle URI and internal links */
-    if(action->type == POPPLER_ACTION_URI)
-    {
-      if(li == link_id)
-        open_uri(action->uri.uri);
-    }
-    else if(action->type == POPPLER_ACTION_GOTO_DEST)
-    {
-      if(li == link_id)
-      {
-        if(action->goto_dest.dest->type == POPPLER_DEST_NAMED)
-        {
-          PopplerDest* destination = poppler_document_find_dest(Zathura.PDF.document, action->goto_dest.dest->named_dest);
-          if(destination)
-          {
-            new_page_id = destination->page_num - 1;
-            poppler_dest_free(destination);
-          }
-        }
-        else
-          new_page_id = action->goto_dest.dest->page_num - 1;
-      }
-    }
-    else
-      continue;
+  g_free(input);
 
-    link_id++;
+  if(li <= 0 || li > links->number_of_links)
+  {
+    set_page(Zathura.PDF.page_number);
+    isc_abort(NULL);
+    notify(WARNING, "Invalid hint");
+    return TRUE;
   }
 
-  poppler_page_free_link_mapping(link_list);
-
-  /* reset all */
-  set_page(new_page_id);
+  /* follow link and reset all */
+  if(!follow_link(links->links[li - 1].action))
+    set_page(Zathura.PDF.page_number);
   isc_abort(NULL);
 
   return TRUE;
@@ -4696,8 +8406,50 @@ cb_inputbar_password_activate(GtkEntry* entry, gpointer data)
   return TRUE;
 }
 
+gboolean
+cb_update_status(gpointer data)
+{
+  update_status();
+  return FALSE;
+}
+
+gboolean
+cb_autosave(gpointer data)
+{
+  store_position();
+  return TRUE;
+}
+
+gboolean
+cb_idle_save(gpointer data)
+{
+  gint64 idle = g_get_monotonic_time() - Zathura.Bookmarks.last_activity;
+  gint64 wait = (gint64) autosave_idle * G_USEC_PER_SEC;
+
+  /* the view changed in the meantime, check again when it could be idle */
+  if(autosave_idle > 0 && idle < wait)
+  {
+    Zathura.Bookmarks.idle_save = gdk_threads_add_timeout((wait - idle) / 1000 + 1, cb_idle_save, NULL);
+    return FALSE;
+  }
+
+  Zathura.Bookmarks.idle_save = 0;
+  store_position();
+  return FALSE;
+}
+
 gboolean
 cb_view_kb_pressed(GtkWidget *widget, GdkEventKey *event, gpointer data)
+{
+  gint64 trace = TRACE_BEGIN();
+  gboolean handled = handle_key_press(event);
+  TRACE_END("input", "key press", trace);
+
+  return handled;
+}
+
+gboolean
+handle_key_press(GdkEventKey *event)
 {
   if(Zathura.Global.mode == ADD_MARKER)
   {
@@ -4712,27 +8464,26 @@ cb_view_kb_pressed(GtkWidget *widget, GdkEventKey *event, gpointer data)
     return TRUE;
   }
 
-  ShortcutList* sc = Zathura.Bindings.sclist;
-  while(sc)
+  GSList* sc = g_hash_table_lookup(Zathura.Bindings.sctable, GINT_TO_POINTER(event->keyval));
+  for(; sc; sc = g_slist_next(sc))
   {
+    Shortcut* shortcut = (Shortcut*) sc->data;
+
     if(
-       event->keyval == sc->element.key
-       && (CLEAN(event->state) == sc->element.mask || (sc->element.key >= 0x21
-       && sc->element.key <= 0x7E && CLEAN(event->state) == GDK_SHIFT_MASK))
-       && (Zathura.Global.mode & sc->element.mode || sc->element.mode == ALL)
-       && sc->element.function
+       (CLEAN(event->state) == shortcut->mask || (shortcut->key >= 0x21
+       && shortcut->key <= 0x7E && CLEAN(event->state) == GDK_SHIFT_MASK))
+       && (Zathura.Global.mode & shortcut->mode || shortcut->mode == ALL)
+       && shortcut->function
       )
     {
-      if(!(Zathura.Global.buffer && strlen(Zathura.Global.buffer->str)) || (sc->element.mask == GDK_CONTROL_MASK) ||
-         (sc->element.key <= 0x21 || sc->element.key >= 0x7E)
+      if(!(Zathura.Global.buffer && strlen(Zathura.Global.buffer->str)) || (shortcut->mask == GDK_CONTROL_MASK) ||
+         (shortcut->key <= 0x21 || shortcut->key >= 0x7E)
         )
       {
-        sc->element.function(&(sc->element.argument));
+        shortcut->function(&(shortcut->argument));
         return TRUE;
       }
     }
-
-    sc = sc->next;
   }
 
   /* append only numbers and characters to buffer */
@@ -4746,19 +8497,13 @@ cb_view_kb_pressed(GtkWidget *widget, GdkEventKey *event, gpointer data)
   }
 
   /* search buffer commands */
-  if(Zathura.Global.buffer)
+  if(Zathura.Global.buffer && (!Zathura.Bindings.bcmatcher_valid ||
+        regexec(&(Zathura.Bindings.bcmatcher), Zathura.Global.buffer->str, (size_t) 0, NULL, 0) == 0))
   {
     int i;
     for(i = 0; i < LENGTH(buffer_commands); i++)
     {
-      regex_t regex;
-      int     status;
-
-      regcomp(&regex, buffer_commands[i].regex, REG_EXTENDED);
-      status = regexec(&regex, Zathura.Global.buffer->str, (size_t) 0, NULL, 0);
-      regfree(&regex);
-
-      if(status == 0)
+      if(regexec(&(Zathura.Bindings.bcregex[i]), Zathura.Global.buffer->str, (size_t) 0, NULL, 0) == 0)
       {
         buffer_commands[i].function(Zathura.Global.buffer->str, &(buffer_commands[i].argument));
         g_string_free(Zathura.Global.buffer, TRUE);
@@ -4803,11 +8548,23 @@ cb_view_button_pressed(GtkWidget* widget, GdkEventButton* event, gpointer data)
 
   /* clean page */
   draw(Zathura.PDF.page_number);
-  g_static_mutex_lock(&(Zathura.Lock.select_lock));
+  LOCK(select_lock);
   Zathura.SelectPoint.x = event->x;
   Zathura.SelectPoint.y = event->y;
   g_static_mutex_unlock(&(Zathura.Lock.select_lock));
 
+  /* the glyph the selection starts at, the text layout is read here so
+   * that dragging does not need poppler */
+  PageText* text = get_page_text_layout(Zathura.PDF.page_number);
+  Zathura.Selection.page  = Zathura.PDF.page_number;
+  Zathura.Selection.first = -1;
+  if(text)
+  {
+    double offset_x, offset_y;
+    calculate_offset(widget, &offset_x, &offset_y);
+    Zathura.Selection.first = find_glyph(text, event->x - offset_x, event->y - offset_y);
+  }
+
   return TRUE;
 }
 
@@ -4825,7 +8582,7 @@ cb_view_button_release(GtkWidget* widget, GdkEventButton* event, gpointer data)
   rectangle.x1 = event->x;
   rectangle.y1 = event->y;
 
-  g_static_mutex_lock(&(Zathura.Lock.select_lock));
+  LOCK(select_lock);
   rectangle.x2 = Zathura.SelectPoint.x;
   rectangle.y2 = Zathura.SelectPoint.y;
   g_static_mutex_unlock(&(Zathura.Lock.select_lock));
@@ -4833,8 +8590,33 @@ cb_view_button_release(GtkWidget* widget, GdkEventButton* event, gpointer data)
   /* calculate offset */
   calculate_offset(widget, &offset_x, &offset_y);
 
+  /* follow a link that was clicked without dragging */
+  if(ABS(rectangle.x2 - rectangle.x1) < 2 && ABS(rectangle.y2 - rectangle.y1) < 2)
+  {
+    Link* link = find_link(Zathura.PDF.page_number, event->x - offset_x, event->y - offset_y);
+    if(link)
+    {
+      follow_link(link->action);
+      return TRUE;
+    }
+  }
+
+  /* copy the highlighted glyphs */
+  PageText* text = Zathura.PDF.pages[Zathura.PDF.page_number]->text;
+  if(Zathura.Selection.active && text && Zathura.Selection.page == Zathura.PDF.page_number)
+  {
+    int first = MIN(Zathura.Selection.first, Zathura.Selection.last);
+    int last  = MAX(Zathura.Selection.first, Zathura.Selection.last);
+
+    gchar* start = g_utf8_offset_to_pointer(text->text, first);
+    gchar* end   = g_utf8_offset_to_pointer(text->text, last + 1);
+    gtk_clipboard_set_text(gtk_clipboard_get(GDK_SELECTION_PRIMARY), start, end - start);
+
+    return TRUE;
+  }
+
   /* draw selection rectangle */
-  cairo = cairo_create(Zathura.PDF.surface);
+  cairo = create_page_context();
   cairo_set_source_rgba(cairo, Zathura.Style.select_text.red, Zathura.Style.select_text.green,
       Zathura.Style.select_text.blue, transparency);
   cairo_rectangle(cairo, rectangle.x1 - offset_x, rectangle.y1 - offset_y,
@@ -4844,7 +8626,7 @@ cb_view_button_release(GtkWidget* widget, GdkEventButton* event, gpointer data)
   gtk_widget_queue_draw(Zathura.UI.drawing_area);
 
   /* resize selection rectangle to document page */
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+  LOCK(pdflib_lock);
   poppler_page_get_size(Zathura.PDF.pages[Zathura.PDF.page_number]->page, &page_width, &page_height);
   g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
 
@@ -4905,7 +8687,7 @@ cb_view_button_release(GtkWidget* widget, GdkEventButton* event, gpointer data)
 #endif
 
   /* get selected text */
-  g_static_mutex_lock(&(Zathura.Lock.pdflib_lock));
+  LOCK(pdflib_lock);
   char* selected_text = poppler_page_get_selected_text(
       Zathura.PDF.pages[Zathura.PDF.page_number]->page,SELECTION_STYLE,
       &rectangle);
@@ -4924,6 +8706,45 @@ cb_view_button_release(GtkWidget* widget, GdkEventButton* event, gpointer data)
 gboolean
 cb_view_motion_notify(GtkWidget* widget, GdkEventMotion* event, gpointer data)
 {
+  if(!Zathura.PDF.document)
+    return TRUE;
+
+  double offset_x, offset_y;
+  calculate_offset(widget, &offset_x, &offset_y);
+
+  /* highlight the selection while dragging */
+  if(event->state & GDK_BUTTON1_MASK)
+  {
+    PageText* text = Zathura.PDF.pages[Zathura.PDF.page_number]->text;
+    if(text && Zathura.Selection.first >= 0 && Zathura.Selection.page == Zathura.PDF.page_number)
+    {
+      int last = find_glyph(text, event->x - offset_x, event->y - offset_y);
+      if(last >= 0 && (!Zathura.Selection.active || last != Zathura.Selection.last))
+      {
+        Zathura.Selection.last   = last;
+        Zathura.Selection.active = TRUE;
+        gtk_widget_queue_draw(Zathura.UI.drawing_area);
+      }
+    }
+
+    gdk_event_request_motions(event);
+    return TRUE;
+  }
+
+  gboolean hover = find_link(Zathura.PDF.page_number, event->x - offset_x, event->y - offset_y) != NULL;
+  if(hover != Zathura.Global.link_hover)
+  {
+    GdkCursor* cursor = hover ? gdk_cursor_new(GDK_HAND2) : NULL;
+    gdk_window_set_cursor(widget->window, cursor);
+    if(cursor)
+      gdk_cursor_unref(cursor);
+
+    Zathura.Global.link_hover = hover;
+  }
+
+  /* ask for the next motion event */
+  gdk_event_request_motions(event);
+
   return TRUE;
 }
 
@@ -4954,6 +8775,391 @@ cb_watch_file(GFileMonitor* monitor, GFile* file, GFile* other_file, GFileMonito
   return TRUE;
 }
 
+/* benchmark implementation */
+int
+run_benchmark(char* file, char* password, const char* scales, const char* rotations,
+    const char* recolors, char** searches)
+{
+  /* nothing else should render while measuring */
+  prefetch_links    = 0;
+  pinned_cache_size = 0;
+
+  gint64 start    = g_get_monotonic_time();
+  gboolean opened = open_file(file, password);
+  double open_ms  = (g_get_monotonic_time() - start) / 1000.0;
+
+  if(!opened)
+  {
+    fprintf(stderr, "error: could not open %s\n", file);
+    return 1;
+  }
+
+  /* let the background scan of the document finish */
+  if(Zathura.Thread.scan_thread)
+  {
+    g_thread_join(Zathura.Thread.scan_thread);
+    Zathura.Thread.scan_thread = NULL;
+  }
+
+  int number_of_pages = Zathura.PDF.number_of_pages;
+
+  gchar** scale_list    = g_strsplit(scales    ? scales    : "100", ",", -1);
+  gchar** rotation_list = g_strsplit(rotations ? rotations : "0",   ",", -1);
+  gchar** recolor_list  = g_strsplit(recolors  ? recolors  : "0",   ",", -1);
+
+  double* times = g_malloc(sizeof(double) * MAX(number_of_pages, 1));
+  GArray* all   = g_array_new(FALSE, FALSE, sizeof(double));
+
+  printf("{\n  \"file\": ");
+  print_json_string(file);
+  printf(",\n  \"pages\": %i,\n  \"open_ms\": %.3f,\n  \"render\": [", number_of_pages, open_ms);
+
+  /* render every page through draw() for every configuration */
+  int s, r, c, i;
+  gboolean first = TRUE;
+  for(s = 0; scale_list[s]; s++)
+  {
+    for(r = 0; rotation_list[r]; r++)
+    {
+      for(c = 0; recolor_list[c]; c++)
+      {
+        Zathura.PDF.scale      = atoi(scale_list[s]);
+        Zathura.PDF.rotate     = atoi(rotation_list[r]);
+        Zathura.Global.recolor = atoi(recolor_list[c]) ? TRUE : FALSE;
+
+        if(Zathura.PDF.scale <= 0 || Zathura.PDF.rotate % 90 != 0)
+          continue;
+
+        for(i = 0; i < number_of_pages; i++)
+        {
+          render_cache_clear();
+
+          start = g_get_monotonic_time();
+          Zathura.PDF.page_number = i;
+          draw(i);
+          times[i] = (g_get_monotonic_time() - start) / 1000.0;
+        }
+
+        g_array_append_vals(all, times, number_of_pages);
+
+        printf("%s\n    { \"scale\": %i, \"rotate\": %i, \"recolor\": %s, \"pages_ms\": [",
+            first ? "" : ",", Zathura.PDF.scale, Zathura.PDF.rotate, Zathura.Global.recolor ? "true" : "false");
+        for(i = 0; i < number_of_pages; i++)
+          printf("%s%.3f", i ? ", " : "", times[i]);
+        printf("], ");
+        print_latency_statistics(times, number_of_pages);
+        printf(" }");
+
+        first = FALSE;
+      }
+    }
+  }
+
+  printf("\n  ],\n  \"render_total\": { ");
+  print_latency_statistics((double*) all->data, all->len);
+  printf(" },\n  \"search\": [");
+
+  /* search every page like the search thread does */
+  const char* default_searches[] = { "the", "zathura-benchmark-no-match", NULL };
+  const char** queries = searches ? (const char**) searches : default_searches;
+
+  int q;
+  for(q = 0; queries[q]; q++)
+  {
+    int hits = 0;
+
+    for(i = 0; i < number_of_pages; i++)
+    {
+      start = g_get_monotonic_time();
+
+      LOCK(pdflib_lock);
+      GList* results = poppler_page_find_text(Zathura.PDF.pages[i]->page, queries[q]);
+      g_static_mutex_unlock(&(Zathura.Lock.pdflib_lock));
+
+      times[i] = (g_get_monotonic_time() - start) / 1000.0;
+
+      hits += g_list_length(results);
+      g_list_free(results);
+    }
+
+    printf("%s\n    { \"query\": ", q ? "," : "");
+    print_json_string(queries[q]);
+    printf(", \"hits\": %i, ", hits);
+    print_latency_statistics(times, number_of_pages);
+    printf(" }");
+  }
+
+  printf("\n  ]\n}\n");
+
+  g_array_free(all, TRUE);
+  g_free(times);
+  g_strfreev(scale_list);
+  g_strfreev(rotation_list);
+  g_strfreev(recolor_list);
+
+  return 0;
+}
+
+void
+print_json_string(const char* string)
+{
+  putchar('"');
+
+  for(; *string; string++)
+  {
+    unsigned char character = *string;
+
+    if(character == '"' || character == '\\')
+      printf("\\%c", character);
+    else if(character < 0x20)
+      printf("\\u%04x", character);
+    else
+      putchar(character);
+  }
+
+  putchar('"');
+}
+
+double
+get_percentile(double* sorted, int n, double percentile)
+{
+  /* nearest rank */
+  int rank = (int) ceil(percentile / 100.0 * n) - 1;
+  return sorted[MIN(n - 1, MAX(0, rank))];
+}
+
+int
+compare_latencies(const void* a, const void* b)
+{
+  double x = *(const double*) a;
+  double y = *(const double*) b;
+
+  return (x > y) - (x < y);
+}
+
+void
+print_latency_statistics(double* times, int n)
+{
+  if(n <= 0)
+  {
+    printf("\"count\": 0");
+    return;
+  }
+
+  double* sorted = g_memdup(times, sizeof(double) * n);
+  qsort(sorted, n, sizeof(double), compare_latencies);
+
+  double total = 0;
+  int i;
+  for(i = 0; i < n; i++)
+    total += sorted[i];
+
+  printf("\"count\": %i, \"total_ms\": %.3f, \"mean_ms\": %.3f, \"min_ms\": %.3f, "
+      "\"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f",
+      n, total, total / n, sorted[0], get_percentile(sorted, n, 50), get_percentile(sorted, n, 90),
+      get_percentile(sorted, n, 99), sorted[n - 1]);
+
+  g_free(sorted);
+}
+
+int
+run_perf_test(char* corpus)
+{
+  /* nothing else should render while measuring */
+  prefetch_links    = 0;
+  pinned_cache_size = 0;
+
+  gdk_threads_enter();
+
+  gtk_widget_show_all(GTK_WIDGET(Zathura.UI.window));
+  flush_events();
+
+  printf("%-14s %-12s %6s %9s %9s %9s %9s\n", "test", "document", "runs",
+      "p50 ms", "budget", "p95 ms", "budget");
+
+  char* document = NULL;
+  int failures   = 0;
+
+  int t, i;
+  for(t = 0; t < LENGTH(perf_tests); t++)
+  {
+    PerfTest* test = &perf_tests[t];
+
+    if(g_strcmp0(document, test->document))
+    {
+      if(Zathura.PDF.document)
+        close_file(FALSE);
+
+      gchar* file     = g_build_filename(corpus, test->document, NULL);
+      gboolean opened = open_file(file, NULL);
+      g_free(file);
+
+      document = opened ? test->document : NULL;
+      if(!opened)
+      {
+        printf("%-14s %-12s could not be opened\n", test->name, test->document);
+        failures++;
+        continue;
+      }
+
+      /* let the background scan of the document finish */
+      if(Zathura.Thread.scan_thread)
+      {
+        gdk_threads_leave();
+        g_thread_join(Zathura.Thread.scan_thread);
+        gdk_threads_enter();
+        Zathura.Thread.scan_thread = NULL;
+      }
+
+      Zathura.Global.adjust_mode = ADJUST_NONE;
+      Zathura.PDF.scale          = 100;
+      set_page(0);
+      flush_events();
+    }
+
+    double* times = g_malloc(sizeof(double) * test->iterations);
+    for(i = 0; i < test->iterations; i++)
+      times[i] = test->function();
+
+    qsort(times, test->iterations, sizeof(double), compare_latencies);
+
+    double p50 = get_percentile(times, test->iterations, 50);
+    double p95 = get_percentile(times, test->iterations, 95);
+    gboolean passed = (p50 <= test->p50_budget && p95 <= test->p95_budget);
+
+    printf("%-14s %-12s %6i %9.3f %9.3f %9.3f %9.3f %s\n", test->name, test->document,
+        test->iterations, p50, test->p50_budget, p95, test->p95_budget, passed ? "ok" : "FAILED");
+
+    if(!passed)
+      failures++;
+
+    g_free(times);
+  }
+
+  if(Zathura.PDF.document)
+    close_file(FALSE);
+
+  gdk_threads_leave();
+
+  printf("\n%i of %i tests failed\n", failures, (int) LENGTH(perf_tests));
+
+  return failures ? 1 : 0;
+}
+
+void
+flush_events(void)
+{
+  /* a step is only finished once its result is on the screen */
+  while(gtk_events_pending())
+    gtk_main_iteration_do(FALSE);
+}
+
+double
+perf_page_turn(void)
+{
+  render_cache_clear();
+
+  gint64 start = g_get_monotonic_time();
+  set_page((Zathura.PDF.page_number + 1) % Zathura.PDF.number_of_pages);
+  flush_events();
+
+  return (g_get_monotonic_time() - start) / 1000.0;
+}
+
+double
+perf_scroll(void)
+{
+  Argument argument;
+  argument.n = NEXT;
+
+  gint64 start = g_get_monotonic_time();
+  sc_scroll(&argument);
+  flush_events();
+
+  return (g_get_monotonic_time() - start) / 1000.0;
+}
+
+double
+perf_zoom(void)
+{
+  /* alternate between the initial and the next zoom level */
+  Argument argument;
+  argument.n = (Zathura.PDF.scale > 100) ? ZOOM_OUT : ZOOM_IN;
+
+  render_cache_clear();
+
+  gint64 start = g_get_monotonic_time();
+  bcmd_zoom(NULL, &argument);
+  flush_events();
+
+  return (g_get_monotonic_time() - start) / 1000.0;
+}
+
+double
+perf_search(void)
+{
+  Argument argument;
+  argument.n    = FORWARD;
+  argument.data = "tempor";
+
+  render_cache_clear();
+
+  /* the search thread switches to the page of the next hit */
+  gint64 start = g_get_monotonic_time();
+  sc_search(&argument);
+
+  LOCK(search_lock);
+  GThread* thread = Zathura.Thread.search_thread;
+  Zathura.Thread.search_thread = NULL;
+  g_static_mutex_unlock(&(Zathura.Lock.search_lock));
+
+  /* no thread is left to wait for if it could not be created */
+  if(thread)
+  {
+    gdk_threads_leave();
+    g_thread_join(thread);
+    gdk_threads_enter();
+  }
+
+  flush_events();
+
+  return (g_get_monotonic_time() - start) / 1000.0;
+}
+
+double
+perf_toggle_index(void)
+{
+  /* start from a document without an index every time */
+  if(Zathura.Global.show_index)
+    sc_toggle_index(NULL);
+
+  free_index();
+  if(Zathura.UI.index)
+  {
+    gtk_widget_destroy(Zathura.UI.index);
+    Zathura.UI.index = NULL;
+  }
+
+  flush_events();
+
+  /* the deeper levels are built in the background once the index is shown,
+   * so the builder is paused before the window is updated and the rest of
+   * the index is dropped after the measurement */
+  gint64 start = g_get_monotonic_time();
+  sc_toggle_index(NULL);
+  if(Zathura.Index.builder)
+  {
+    g_source_remove(Zathura.Index.builder);
+    Zathura.Index.builder = 0;
+  }
+  flush_events();
+
+  double time = (g_get_monotonic_time() - start) / 1000.0;
+  free_index();
+
+  return time;
+}
+
 /* main function */
 int main(int argc, char* argv[])
 {
@@ -4965,11 +9171,27 @@ int main(int argc, char* argv[])
 
   char* config_dir = 0;
   char* data_dir = 0;
+
+  gboolean bench           = FALSE;
+  char*    bench_scales    = NULL;
+  char*    bench_rotations = NULL;
+  char*    bench_recolor   = NULL;
+  char**   bench_searches  = NULL;
+  char*    perf_test       = NULL;
+  gboolean trace           = FALSE;
+
   GOptionEntry entries[] =
   {
-    { "reparent",   'e', 0, G_OPTION_ARG_INT,      &Zathura.UI.embed, "Reparents to window specified by xid", "xid" },
-    { "config-dir", 'c', 0, G_OPTION_ARG_FILENAME, &config_dir,       "Path to the config directory",         "path" },
-    { "data-dir",   'd', 0, G_OPTION_ARG_FILENAME, &data_dir,         "Path to the data directory",           "path" },
+    { "reparent",        'e', 0, G_OPTION_ARG_INT,          &Zathura.UI.embed, "Reparents to window specified by xid",               "xid" },
+    { "config-dir",      'c', 0, G_OPTION_ARG_FILENAME,     &config_dir,       "Path to the config directory",                       "path" },
+    { "data-dir",        'd', 0, G_OPTION_ARG_FILENAME,     &data_dir,         "Path to the data directory",                         "path" },
+    { "bench",           0,   0, G_OPTION_ARG_NONE,         &bench,            "Benchmark rendering and searching the file and exit", NULL },
+    { "bench-scales",    0,   0, G_OPTION_ARG_STRING,       &bench_scales,     "Zoom levels to benchmark (default: 100)",            "list" },
+    { "bench-rotations", 0,   0, G_OPTION_ARG_STRING,       &bench_rotations,  "Rotations to benchmark (default: 0)",                "list" },
+    { "bench-recolor",   0,   0, G_OPTION_ARG_STRING,       &bench_recolor,    "Recolor settings to benchmark (default: 0)",         "list" },
+    { "bench-search",    0,   0, G_OPTION_ARG_STRING_ARRAY, &bench_searches,   "Search term to benchmark (repeatable)",              "term" },
+    { "perf-test",       0,   0, G_OPTION_ARG_FILENAME,     &perf_test,        "Check latency budgets against the documents in path", "path" },
+    { "trace",           0,   0, G_OPTION_ARG_NONE,         &trace,            "Write a trace of render, search and input events",   NULL },
     { NULL }
   };
 
@@ -5004,6 +9226,31 @@ int main(int argc, char* argv[])
   init_bookmarks();
   init_look();
 
+  if(trace)
+    Zathura.Trace.enabled = TRUE;
+
+  /* the window is never shown in benchmark mode */
+  if(bench)
+  {
+    if(argc < 2)
+    {
+      fprintf(stderr, "error: --bench needs a file\n");
+      return 1;
+    }
+
+    int status = run_benchmark(argv[1], (argc == 3) ? argv[2] : NULL, bench_scales,
+        bench_rotations, bench_recolor, bench_searches);
+    close_trace();
+    return status;
+  }
+
+  if(perf_test)
+  {
+    int status = run_perf_test(perf_test);
+    close_trace();
+    return status;
+  }
+
   if(argc > 1)
   {
     char* password = (argc == 3) ? argv[2] : NULL;